@@ -0,0 +1,14 @@
+#ifndef _BITS_CRC32_H
+#define _BITS_CRC32_H
+
+/** @file
+ *
+ * i386-specific CRC32
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#define crc32_le generic_crc32_le
+
+#endif /* _BITS_CRC32_H */
@@ -50,6 +50,15 @@ __kernel_ssize_t linux_write ( int fd, const void *buf,
 	return linux_syscall  (  __NR_write, fd, buf, count );
 }
 
+__kernel_ssize_t linux_readv ( int fd, const struct iovec *iov, int iovcnt ) {
+	return linux_syscall ( __NR_readv, fd, iov, iovcnt );
+}
+
+__kernel_ssize_t linux_writev ( int fd, const struct iovec *iov,
+				int iovcnt ) {
+	return linux_syscall ( __NR_writev, fd, iov, iovcnt );
+}
+
 int linux_fcntl ( int fd, int cmd, ... ) {
 	long arg;
 	va_list list;
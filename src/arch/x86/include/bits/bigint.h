@@ -311,6 +311,45 @@ bigint_done_raw ( const uint32_t *value0, unsigned int size __unused,
 			       : "eax" );
 }
 
+/**
+ * Multiply big integer by a single element and accumulate
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier	Element by which to multiply
+ * @v value0		Element 0 of big integer to be added to
+ * @v size		Number of elements
+ * @ret carry		Carry out of most significant element
+ */
+static inline __attribute__ (( always_inline )) uint32_t
+bigint_multiply_add_raw ( const uint32_t *multiplicand0, uint32_t multiplier,
+			  uint32_t *value0, unsigned int size ) {
+	uint32_t carry;
+	void *discard_S;
+	void *discard_D;
+	long discard_c;
+	uint32_t discard_a;
+	uint32_t discard_d;
+
+	__asm__ __volatile__ ( "xorl %0, %0\n\t"
+			       "\n1:\n\t"
+			       "lodsl\n\t"
+			       "mull %9\n\t"
+			       "addl %0, %%eax\n\t"
+			       "adcl $0, %%edx\n\t"
+			       "addl %%eax, (%2)\n\t"
+			       "adcl $0, %%edx\n\t"
+			       "movl %%edx, %0\n\t"
+			       "lea 4(%2), %2\n\t"
+			       "loop 1b\n\t"
+			       : "=&r" ( carry ), "=&S" ( discard_S ),
+				 "=&D" ( discard_D ), "=&c" ( discard_c ),
+				 "=&a" ( discard_a ), "=&d" ( discard_d )
+			       : "1" ( multiplicand0 ), "2" ( value0 ),
+				 "3" ( size ), "rm" ( multiplier )
+			       : "memory" );
+	return carry;
+}
+
 extern void bigint_multiply_raw ( const uint32_t *multiplicand0,
 				  const uint32_t *multiplier0,
 				  uint32_t *value0, unsigned int size );
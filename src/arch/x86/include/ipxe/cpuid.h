@@ -39,6 +39,9 @@ struct x86_features {
 /** Get standard features */
 #define CPUID_FEATURES 0x00000001UL
 
+/** PCLMULQDQ instruction is supported */
+#define CPUID_FEATURES_INTEL_ECX_PCLMUL 0x00000002UL
+
 /** Hypervisor is present */
 #define CPUID_FEATURES_INTEL_ECX_HYPERVISOR 0x80000000UL
 
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * x86_64 CRC32
+ *
+ * Large buffers are checksummed using carry-less multiplication
+ * (PCLMULQDQ) to fold the data 64 bytes at a time, as described in
+ * Intel's "Fast CRC Computation for Generic Polynomials Using
+ * PCLMULQDQ Instruction" white paper.  The folded value is reduced to
+ * a 32-bit CRC using a bit-reflected Barrett reduction.
+ */
+
+#include <stdint.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/crc32.h>
+
+/** Minimum length for which PCLMULQDQ folding is used */
+#define CRC32_PCLMUL_MIN_LEN 64
+
+/** PCLMULQDQ folding alignment */
+#define CRC32_PCLMUL_ALIGN 16
+
+/** PCLMULQDQ folding constants */
+struct x86_64_crc32_constants {
+	/** Fold by 512 bits: x^(4*128+32) and x^(4*128-32) mod P */
+	uint64_t r2r1[2];
+	/** Fold by 128 bits: x^(128+32) and x^(128-32) mod P */
+	uint64_t r4r3[2];
+	/** Fold by 64 bits: x^64 mod P */
+	uint64_t r5[2];
+	/** Low 32-bit mask */
+	uint64_t mask32[2];
+	/** Barrett reduction: polynomial P and floor(x^64/P) */
+	uint64_t rupoly[2];
+} __attribute__ (( aligned ( 16 ) ));
+
+/** PCLMULQDQ folding constants for the (bit-reflected) CRC32 polynomial */
+static const struct x86_64_crc32_constants x86_64_crc32_constants = {
+	.r2r1 = { 0x0000000154442bd4ULL, 0x00000001c6e41596ULL },
+	.r4r3 = { 0x00000001751997d0ULL, 0x00000000ccaa009eULL },
+	.r5 = { 0x0000000163cd6124ULL, 0 },
+	.mask32 = { 0x00000000ffffffffULL, 0 },
+	.rupoly = { 0x00000001db710641ULL, 0x00000001f7011641ULL },
+};
+
+/** PCLMULQDQ support state */
+enum x86_64_crc32_pclmul {
+	/** Support has not yet been checked */
+	CRC32_PCLMUL_UNKNOWN = 0,
+	/** PCLMULQDQ is not supported */
+	CRC32_PCLMUL_ABSENT,
+	/** PCLMULQDQ is supported */
+	CRC32_PCLMUL_PRESENT,
+};
+
+/** PCLMULQDQ support */
+static enum x86_64_crc32_pclmul x86_64_crc32_pclmul;
+
+/**
+ * Check for PCLMULQDQ support
+ *
+ * @ret supported	PCLMULQDQ is supported
+ */
+static int x86_64_crc32_pclmul_supported ( void ) {
+	struct x86_features features;
+
+	/* Check CPU features, if not already done */
+	if ( x86_64_crc32_pclmul == CRC32_PCLMUL_UNKNOWN ) {
+		x86_features ( &features );
+		if ( features.intel.ecx & CPUID_FEATURES_INTEL_ECX_PCLMUL ) {
+			DBGC ( &x86_64_crc32_pclmul, "CRC32 using PCLMULQDQ\n" );
+			x86_64_crc32_pclmul = CRC32_PCLMUL_PRESENT;
+		} else {
+			x86_64_crc32_pclmul = CRC32_PCLMUL_ABSENT;
+		}
+	}
+
+	return ( x86_64_crc32_pclmul == CRC32_PCLMUL_PRESENT );
+}
+
+/**
+ * Calculate 32-bit little-endian CRC checksum using PCLMULQDQ
+ *
+ * @v seed		Initial value
+ * @v data		Data to checksum (must be 16-byte aligned)
+ * @v len		Length of data (must be a multiple of 16, minimum 64)
+ * @ret crc		CRC checksum
+ */
+static u32 x86_64_crc32_le_pclmul ( u32 seed, const void *data,
+				    size_t len ) {
+	const struct x86_64_crc32_constants *constants =
+		&x86_64_crc32_constants;
+	u32 crc;
+
+	__asm__ __volatile__ ( /* Load first 64 bytes and add seed */
+			       "movdqa (%1), %%xmm1\n\t"
+			       "movdqa 0x10(%1), %%xmm2\n\t"
+			       "movdqa 0x20(%1), %%xmm3\n\t"
+			       "movdqa 0x30(%1), %%xmm4\n\t"
+			       "movd %k0, %%xmm0\n\t"
+			       "pxor %%xmm0, %%xmm1\n\t"
+			       "add $0x40, %1\n\t"
+			       "sub $0x40, %2\n\t"
+			       "movdqa %3, %%xmm0\n\t"
+			       "cmp $0x40, %2\n\t"
+			       "jb 2f\n\t"
+			       /* Fold 64 bytes at a time */
+			       "\n1:\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "movdqa %%xmm2, %%xmm6\n\t"
+			       "movdqa %%xmm3, %%xmm7\n\t"
+			       "movdqa %%xmm4, %%xmm8\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm2\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm3\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm4\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm6\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm7\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm8\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor %%xmm6, %%xmm2\n\t"
+			       "pxor %%xmm7, %%xmm3\n\t"
+			       "pxor %%xmm8, %%xmm4\n\t"
+			       "pxor (%1), %%xmm1\n\t"
+			       "pxor 0x10(%1), %%xmm2\n\t"
+			       "pxor 0x20(%1), %%xmm3\n\t"
+			       "pxor 0x30(%1), %%xmm4\n\t"
+			       "add $0x40, %1\n\t"
+			       "sub $0x40, %2\n\t"
+			       "cmp $0x40, %2\n\t"
+			       "jae 1b\n\t"
+			       /* Fold four 128-bit values into one */
+			       "\n2:\n\t"
+			       "movdqa %4, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor %%xmm2, %%xmm1\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor %%xmm3, %%xmm1\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor %%xmm4, %%xmm1\n\t"
+			       /* Fold remaining data 16 bytes at a time */
+			       "cmp $0x10, %2\n\t"
+			       "jb 4f\n\t"
+			       "\n3:\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor (%1), %%xmm1\n\t"
+			       "add $0x10, %1\n\t"
+			       "sub $0x10, %2\n\t"
+			       "cmp $0x10, %2\n\t"
+			       "jae 3b\n\t"
+			       /* Fold 128 bits to 64 bits */
+			       "\n4:\n\t"
+			       "pclmulqdq $0x01, %%xmm1, %%xmm0\n\t"
+			       "psrldq $0x08, %%xmm1\n\t"
+			       "pxor %%xmm0, %%xmm1\n\t"
+			       /* Fold 64 bits to 32 bits */
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "movdqa %5, %%xmm0\n\t"
+			       "movdqa %6, %%xmm3\n\t"
+			       "psrldq $0x04, %%xmm2\n\t"
+			       "pand %%xmm3, %%xmm1\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pxor %%xmm2, %%xmm1\n\t"
+			       /* Perform Barrett reduction */
+			       "movdqa %7, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "pand %%xmm3, %%xmm1\n\t"
+			       "pclmulqdq $0x10, %%xmm0, %%xmm1\n\t"
+			       "pand %%xmm3, %%xmm1\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pxor %%xmm2, %%xmm1\n\t"
+			       "psrldq $0x04, %%xmm1\n\t"
+			       "movd %%xmm1, %k0\n\t"
+			       : "=&r" ( crc ), "+r" ( data ), "+r" ( len )
+			       : "m" ( constants->r2r1 ),
+				 "m" ( constants->r4r3 ),
+				 "m" ( constants->r5 ),
+				 "m" ( constants->mask32 ),
+				 "m" ( constants->rupoly ),
+				 "0" ( seed )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4",
+				 "xmm5", "xmm6", "xmm7", "xmm8", "memory" );
+
+	return crc;
+}
+
+/**
+ * Calculate 32-bit little-endian CRC checksum
+ *
+ * @v seed	Initial value
+ * @v data	Data to checksum
+ * @v len	Length of data
+ *
+ * Usually @a seed is initially zero or all one bits, depending on the
+ * protocol. To continue a CRC checksum over multiple calls, pass the
+ * return value from one call as the @a seed parameter to the next.
+ */
+u32 x86_64_crc32_le ( u32 seed, const void *data, size_t len ) {
+	u32 crc = seed;
+	size_t offset;
+	size_t bulk;
+
+	/* Use generic implementation for short buffers or if
+	 * PCLMULQDQ is not supported.
+	 */
+	offset = ( ( -( ( intptr_t ) data ) ) & ( CRC32_PCLMUL_ALIGN - 1 ) );
+	if ( ( len < ( offset + CRC32_PCLMUL_MIN_LEN ) ) ||
+	     ( ! x86_64_crc32_pclmul_supported() ) ) {
+		return generic_crc32_le ( crc, data, len );
+	}
+
+	/* Process unaligned start using generic implementation */
+	crc = generic_crc32_le ( crc, data, offset );
+	data += offset;
+	len -= offset;
+
+	/* Process aligned blocks using PCLMULQDQ */
+	bulk = ( len & ~( CRC32_PCLMUL_ALIGN - 1 ) );
+	crc = x86_64_crc32_le_pclmul ( crc, data, bulk );
+	data += bulk;
+	len -= bulk;
+
+	/* Process unaligned end using generic implementation */
+	return generic_crc32_le ( crc, data, len );
+}
@@ -0,0 +1,16 @@
+#ifndef _BITS_CRC32_H
+#define _BITS_CRC32_H
+
+/** @file
+ *
+ * x86_64-specific CRC32
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern u32 x86_64_crc32_le ( u32 seed, const void *data, size_t len );
+
+#define crc32_le x86_64_crc32_le
+
+#endif /* _BITS_CRC32_H */
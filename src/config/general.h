@@ -135,6 +135,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define PING_CMD		/* Ping command */
 //#define CONSOLE_CMD		/* Console command */
 //#define IPSTAT_CMD		/* IP statistics commands */
+//#define DNS_CMD		/* DNS cache statistics command */
 //#define PROFSTAT_CMD		/* Profiling commands */
 
 /*
@@ -30,10 +30,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
 #include <ipxe/job.h>
-#include <ipxe/uaccess.h>
-#include <ipxe/umalloc.h>
 #include <ipxe/image.h>
 #include <ipxe/profile.h>
+#include <ipxe/xferbuf.h>
 #include <ipxe/downloader.h>
 
 /** @file
@@ -62,8 +61,8 @@ struct downloader {
 
 	/** Image to contain downloaded file */
 	struct image *image;
-	/** Current position within image buffer */
-	size_t pos;
+	/** Data transfer buffer */
+	struct xfer_buffer buffer;
 };
 
 /**
@@ -87,6 +86,10 @@ static void downloader_free ( struct refcnt *refcnt ) {
  */
 static void downloader_finished ( struct downloader *downloader, int rc ) {
 
+	/* Release any excess buffer allocation */
+	xferbuf_trim ( &downloader->buffer );
+	downloader->image->len = downloader->buffer.len;
+
 	/* Log download status */
 	if ( rc == 0 ) {
 		syslog ( LOG_NOTICE, "Downloaded \"%s\"\n",
@@ -101,37 +104,6 @@ static void downloader_finished ( struct downloader *downloader, int rc ) {
 	intf_shutdown ( &downloader->job, rc );
 }
 
-/**
- * Ensure that download buffer is large enough for the specified size
- *
- * @v downloader	Downloader
- * @v len		Required minimum size
- * @ret rc		Return status code
- */
-static int downloader_ensure_size ( struct downloader *downloader,
-				    size_t len ) {
-	userptr_t new_buffer;
-
-	/* If buffer is already large enough, do nothing */
-	if ( len <= downloader->image->len )
-		return 0;
-
-	DBGC ( downloader, "Downloader %p extending to %zd bytes\n",
-	       downloader, len );
-
-	/* Extend buffer */
-	new_buffer = urealloc ( downloader->image->data, len );
-	if ( ! new_buffer ) {
-		DBGC ( downloader, "Downloader %p could not extend buffer to "
-		       "%zd bytes\n", downloader, len );
-		return -ENOSPC;
-	}
-	downloader->image->data = new_buffer;
-	downloader->image->len = len;
-
-	return 0;
-}
-
 /****************************************************************************
  *
  * Job control interface
@@ -152,8 +124,8 @@ static int downloader_progress ( struct downloader *downloader,
 	 * arrive out of order (e.g. with multicast protocols), but
 	 * it's a reasonable first approximation.
 	 */
-	progress->completed = downloader->pos;
-	progress->total = downloader->image->len;
+	progress->completed = downloader->buffer.pos;
+	progress->total = downloader->buffer.len;
 
 	return 0;
 }
@@ -175,44 +147,52 @@ static int downloader_progress ( struct downloader *downloader,
 static int downloader_xfer_deliver ( struct downloader *downloader,
 				     struct io_buffer *iobuf,
 				     struct xfer_metadata *meta ) {
-	size_t len;
-	size_t max;
 	int rc;
 
 	/* Start profiling */
 	profile_start ( &downloader_rx_profiler );
 
-	/* Calculate new buffer position */
-	if ( meta->flags & XFER_FL_ABS_OFFSET )
-		downloader->pos = 0;
-	downloader->pos += meta->offset;
-
-	/* Ensure that we have enough buffer space for this data */
-	len = iob_len ( iobuf );
-	max = ( downloader->pos + len );
-	if ( ( rc = downloader_ensure_size ( downloader, max ) ) != 0 )
-		goto done;
-
-	/* Copy data to buffer */
+	/* Add data to buffer */
 	profile_start ( &downloader_copy_profiler );
-	copy_to_user ( downloader->image->data, downloader->pos,
-		       iobuf->data, len );
+	rc = xferbuf_deliver ( &downloader->buffer, iob_disown ( iobuf ),
+			       meta );
 	profile_stop ( &downloader_copy_profiler );
+	if ( rc != 0 ) {
+		DBGC ( downloader, "Downloader %p could not add data to "
+		       "buffer: %s\n", downloader, strerror ( rc ) );
+		downloader_finished ( downloader, rc );
+		goto done;
+	}
 
-	/* Update current buffer position */
-	downloader->pos += len;
+	/* Keep image length in step with buffer */
+	downloader->image->len = downloader->buffer.len;
 
  done:
-	free_iob ( iobuf );
-	if ( rc != 0 )
-		downloader_finished ( downloader, rc );
 	profile_stop ( &downloader_rx_profiler );
 	return rc;
 }
 
+/**
+ * Get underlying data transfer buffer
+ *
+ * @v downloader	Downloader
+ * @ret xferbuf		Data transfer buffer, or NULL on error
+ *
+ * Protocols which receive data in blocks may use this to write
+ * directly into the image, avoiding the need to construct an I/O
+ * buffer only for its contents to be copied again.
+ */
+static struct xfer_buffer *
+downloader_buffer ( struct downloader *downloader ) {
+
+	/* The image length is updated on completion */
+	return &downloader->buffer;
+}
+
 /** Downloader data transfer interface operations */
 static struct interface_operation downloader_xfer_operations[] = {
 	INTF_OP ( xfer_deliver, struct downloader *, downloader_xfer_deliver ),
+	INTF_OP ( xfer_buffer, struct downloader *, downloader_buffer ),
 	INTF_OP ( intf_close, struct downloader *, downloader_finished ),
 };
 
@@ -266,6 +246,9 @@ int create_downloader ( struct interface *job, struct image *image ) {
 	intf_init ( &downloader->xfer, &downloader_xfer_desc,
 		    &downloader->refcnt );
 	downloader->image = image_get ( image );
+	xferbuf_umalloc_init ( &downloader->buffer, &image->data );
+	downloader->buffer.len = image->len;
+	downloader->buffer.alloc = image->len;
 
 	/* Instantiate child objects and attach to our interfaces */
 	if ( ( rc = xfer_open_uri ( &downloader->xfer, image->uri ) ) != 0 )
@@ -28,12 +28,19 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <errno.h>
 #include <ipxe/xfer.h>
 #include <ipxe/iobuf.h>
+#include <ipxe/umalloc.h>
 #include <ipxe/xferbuf.h>
 
 /** @file
  *
  * Data transfer buffer
  *
+ * A data transfer buffer grows geometrically as data is delivered,
+ * so that receiving an image of unknown length requires only a
+ * logarithmic number of reallocations (and hence copies).  Any
+ * excess allocation can be released via xferbuf_trim() once the
+ * transfer is complete.
+ *
  */
 
 /**
@@ -42,9 +49,11 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  * @v xferbuf		Data transfer buffer
  */
 void xferbuf_done ( struct xfer_buffer *xferbuf ) {
-	free ( xferbuf->data );
-	xferbuf->data = NULL;
+
+	/* Free allocated data */
+	xferbuf->op->realloc ( xferbuf, 0 );
 	xferbuf->len = 0;
+	xferbuf->alloc = 0;
 	xferbuf->pos = 0;
 }
 
@@ -53,28 +62,128 @@ void xferbuf_done ( struct xfer_buffer *xferbuf ) {
  *
  * @v xferbuf		Data transfer buffer
  * @v len		Required minimum size
+ * @v exact		Allocate exactly the required size
  * @ret rc		Return status code
  */
-static int xferbuf_ensure_size ( struct xfer_buffer *xferbuf, size_t len ) {
-	void *new_data;
+static int xferbuf_ensure_size ( struct xfer_buffer *xferbuf, size_t len,
+				 int exact ) {
+	size_t alloc;
+	int rc;
 
 	/* If buffer is already large enough, do nothing */
 	if ( len <= xferbuf->len )
 		return 0;
 
-	/* Extend buffer */
-	new_data = realloc ( xferbuf->data, len );
-	if ( ! new_data ) {
-		DBGC ( xferbuf, "XFERBUF %p could not extend buffer to "
-		       "%zd bytes\n", xferbuf, len );
-		return -ENOSPC;
+	/* Extend allocation, if necessary */
+	if ( len > xferbuf->alloc ) {
+
+		/* Grow by at least half of the current allocation,
+		 * unless we have been told the exact size required
+		 * (e.g. via a length hint from xfer_seek()).
+		 */
+		alloc = len;
+		if ( ! exact ) {
+			alloc = ( xferbuf->alloc + ( xferbuf->alloc / 2 ) );
+			if ( alloc < XFERBUF_MIN_ALLOC )
+				alloc = XFERBUF_MIN_ALLOC;
+			if ( alloc < len )
+				alloc = len;
+		}
+
+		/* Reallocate buffer, falling back to the exact
+		 * required size if memory is too tight to allow for
+		 * geometric growth.
+		 */
+		rc = xferbuf->op->realloc ( xferbuf, alloc );
+		if ( ( rc != 0 ) && ( alloc != len ) ) {
+			alloc = len;
+			rc = xferbuf->op->realloc ( xferbuf, alloc );
+		}
+		if ( rc != 0 ) {
+			DBGC ( xferbuf, "XFERBUF %p could not extend buffer to "
+			       "%zd bytes: %s\n", xferbuf, len,
+			       strerror ( rc ) );
+			return rc;
+		}
+		DBGC2 ( xferbuf, "XFERBUF %p extended to %zd bytes (%zd "
+			"allocated)\n", xferbuf, len, alloc );
+		xferbuf->alloc = alloc;
 	}
-	xferbuf->data = new_data;
+
+	/* Record new length */
 	xferbuf->len = len;
 
 	return 0;
 }
 
+/**
+ * Set minimum size of data transfer buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v len		Expected total size
+ * @ret rc		Return status code
+ *
+ * The buffer will be allocated at exactly the specified size, so
+ * that no further reallocations are required if the hint is
+ * accurate.
+ */
+int xferbuf_presize ( struct xfer_buffer *xferbuf, size_t len ) {
+
+	return xferbuf_ensure_size ( xferbuf, len, 1 );
+}
+
+/**
+ * Write to data transfer buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v offset		Starting offset
+ * @v data		Data to write
+ * @v len		Length of data
+ * @ret rc		Return status code
+ */
+int xferbuf_write ( struct xfer_buffer *xferbuf, size_t offset,
+		    const void *data, size_t len ) {
+	size_t max_len;
+	int rc;
+
+	/* Check for overflow */
+	max_len = ( offset + len );
+	if ( max_len < offset )
+		return -EOVERFLOW;
+
+	/* Ensure buffer is large enough to contain this write */
+	if ( ( rc = xferbuf_ensure_size ( xferbuf, max_len, 0 ) ) != 0 )
+		return rc;
+
+	/* Copy data to buffer */
+	xferbuf->op->write ( xferbuf, offset, data, len );
+
+	return 0;
+}
+
+/**
+ * Read from data transfer buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v offset		Starting offset
+ * @v data		Data to read
+ * @v len		Length of data
+ * @ret rc		Return status code
+ */
+int xferbuf_read ( struct xfer_buffer *xferbuf, size_t offset,
+		   void *data, size_t len ) {
+
+	/* Check that read is within buffer range */
+	if ( ( offset > xferbuf->len ) ||
+	     ( len > ( xferbuf->len - offset ) ) )
+		return -ENOENT;
+
+	/* Copy data from buffer */
+	xferbuf->op->read ( xferbuf, offset, data, len );
+
+	return 0;
+}
+
 /**
  * Add received data to data transfer buffer
  *
@@ -82,11 +191,13 @@ static int xferbuf_ensure_size ( struct xfer_buffer *xferbuf, size_t len ) {
  * @v iobuf		I/O buffer
  * @v meta		Data transfer metadata
  * @ret rc		Return status code
+ *
+ * A zero-length delivery (as generated by xfer_seek()) is treated as
+ * a hint of the total transfer size.
  */
 int xferbuf_deliver ( struct xfer_buffer *xferbuf, struct io_buffer *iobuf,
 		      struct xfer_metadata *meta ) {
-	size_t len;
-	size_t max;
+	size_t len = iob_len ( iobuf );
 	int rc;
 
 	/* Calculate new buffer position */
@@ -94,15 +205,15 @@ int xferbuf_deliver ( struct xfer_buffer *xferbuf, struct io_buffer *iobuf,
 		xferbuf->pos = 0;
 	xferbuf->pos += meta->offset;
 
-	/* Ensure that we have enough buffer space for this data */
-	len = iob_len ( iobuf );
-	max = ( xferbuf->pos + len );
-	if ( ( rc = xferbuf_ensure_size ( xferbuf, max ) ) != 0 )
+	/* Write data to buffer, or treat empty delivery as a size hint */
+	if ( len ) {
+		rc = xferbuf_write ( xferbuf, xferbuf->pos, iobuf->data, len );
+	} else {
+		rc = xferbuf_presize ( xferbuf, xferbuf->pos );
+	}
+	if ( rc != 0 )
 		goto done;
 
-	/* Copy data to buffer */
-	memcpy ( ( xferbuf->data + xferbuf->pos ), iobuf->data, len );
-
 	/* Update current buffer position */
 	xferbuf->pos += len;
 
@@ -110,3 +221,180 @@ int xferbuf_deliver ( struct xfer_buffer *xferbuf, struct io_buffer *iobuf,
 	free_iob ( iobuf );
 	return rc;
 }
+
+/**
+ * Release any excess allocation from data transfer buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ */
+void xferbuf_trim ( struct xfer_buffer *xferbuf ) {
+
+	/* Do nothing unless there is excess allocation to release */
+	if ( ( xferbuf->len == 0 ) || ( xferbuf->alloc == xferbuf->len ) )
+		return;
+
+	/* Shrink buffer.  Failure is harmless, since the existing
+	 * allocation is still valid.
+	 */
+	if ( xferbuf->op->realloc ( xferbuf, xferbuf->len ) == 0 )
+		xferbuf->alloc = xferbuf->len;
+}
+
+/**
+ * Reallocate malloc()-based data buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v len		New allocated length (or zero to free)
+ * @ret rc		Return status code
+ */
+static int xferbuf_malloc_realloc ( struct xfer_buffer *xferbuf, size_t len ) {
+	void *new_data;
+
+	/* Free buffer, if applicable */
+	if ( ! len ) {
+		free ( xferbuf->data );
+		xferbuf->data = NULL;
+		return 0;
+	}
+
+	/* Reallocate buffer */
+	new_data = realloc ( xferbuf->data, len );
+	if ( ! new_data )
+		return -ENOSPC;
+	xferbuf->data = new_data;
+	return 0;
+}
+
+/**
+ * Write data to malloc()-based data buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v offset		Starting offset
+ * @v data		Data to copy
+ * @v len		Length of data
+ */
+static void xferbuf_malloc_write ( struct xfer_buffer *xferbuf, size_t offset,
+				   const void *data, size_t len ) {
+
+	memcpy ( ( xferbuf->data + offset ), data, len );
+}
+
+/**
+ * Read data from malloc()-based data buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v offset		Starting offset
+ * @v data		Data to read
+ * @v len		Length of data
+ */
+static void xferbuf_malloc_read ( struct xfer_buffer *xferbuf, size_t offset,
+				  void *data, size_t len ) {
+
+	memcpy ( data, ( xferbuf->data + offset ), len );
+}
+
+/** malloc()-based data buffer operations */
+struct xfer_buffer_operations xferbuf_malloc_operations = {
+	.realloc = xferbuf_malloc_realloc,
+	.write = xferbuf_malloc_write,
+	.read = xferbuf_malloc_read,
+};
+
+/**
+ * Reallocate umalloc()-based data buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v len		New allocated length (or zero to free)
+ * @ret rc		Return status code
+ */
+static int xferbuf_umalloc_realloc ( struct xfer_buffer *xferbuf, size_t len ) {
+	userptr_t *udata = xferbuf->data;
+	userptr_t new_udata;
+
+	/* Free buffer, if applicable */
+	if ( ! len ) {
+		ufree ( *udata );
+		*udata = UNULL;
+		return 0;
+	}
+
+	/* Reallocate buffer */
+	new_udata = urealloc ( *udata, len );
+	if ( ! new_udata )
+		return -ENOSPC;
+	*udata = new_udata;
+	return 0;
+}
+
+/**
+ * Write data to umalloc()-based data buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v offset		Starting offset
+ * @v data		Data to copy
+ * @v len		Length of data
+ */
+static void xferbuf_umalloc_write ( struct xfer_buffer *xferbuf, size_t offset,
+				    const void *data, size_t len ) {
+	userptr_t *udata = xferbuf->data;
+
+	copy_to_user ( *udata, offset, data, len );
+}
+
+/**
+ * Read data from umalloc()-based data buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v offset		Starting offset
+ * @v data		Data to read
+ * @v len		Length of data
+ */
+static void xferbuf_umalloc_read ( struct xfer_buffer *xferbuf, size_t offset,
+				   void *data, size_t len ) {
+	userptr_t *udata = xferbuf->data;
+
+	copy_from_user ( data, *udata, offset, len );
+}
+
+/** umalloc()-based data buffer operations */
+struct xfer_buffer_operations xferbuf_umalloc_operations = {
+	.realloc = xferbuf_umalloc_realloc,
+	.write = xferbuf_umalloc_write,
+	.read = xferbuf_umalloc_read,
+};
+
+/**
+ * Get underlying data transfer buffer
+ *
+ * @v interface		Data transfer interface
+ * @ret xferbuf		Data transfer buffer, or NULL on error
+ *
+ * This call will check that the xfer_buffer() handler belongs to the
+ * destination interface which also handles xfer_deliver(), so that
+ * a protocol may write received data directly into the buffer (and
+ * avoid an intermediate copy via an I/O buffer) only when it would
+ * otherwise have delivered that data to the buffer's owner.
+ */
+struct xfer_buffer * xfer_buffer ( struct interface *intf ) {
+	struct interface *dest;
+	xfer_buffer_TYPE ( void * ) *op =
+		intf_get_dest_op ( intf, xfer_buffer, &dest );
+	void *object = intf_object ( dest );
+	struct interface *xfer_deliver_dest;
+	struct xfer_buffer *xferbuf;
+
+	/* Check that this operation is provided by the same object
+	 * as handles xfer_deliver().
+	 */
+	( void ) intf_get_dest_op ( intf, xfer_deliver, &xfer_deliver_dest );
+	if ( op && ( object == intf_object ( xfer_deliver_dest ) ) ) {
+		xferbuf = op ( object );
+	} else {
+		/* Default is to not have a data transfer buffer */
+		xferbuf = NULL;
+	}
+
+	intf_put ( xfer_deliver_dest );
+	intf_put ( dest );
+	return xferbuf;
+}
@@ -90,6 +90,104 @@ void bigint_mod_multiply_raw ( const bigint_element_t *multiplicand0,
 	assert ( bigint_is_geq ( modulus, result ) );
 }
 
+/**
+ * Calculate Montgomery inverse of big integer modulus
+ *
+ * @v modulus0		Element 0 of big integer modulus (must be odd)
+ * @ret modinv		Negated inverse of element 0 of modulus
+ *
+ * Calculates -N^{-1} mod 2^{w}, where w is the width of a big
+ * integer element.
+ */
+bigint_element_t
+bigint_montgomery_inverse_raw ( const bigint_element_t *modulus0 ) {
+	bigint_element_t modulus = *modulus0;
+	bigint_element_t inverse;
+	unsigned int bits;
+
+	/* Sanity check */
+	assert ( modulus & 1 );
+
+	/* Use Newton's method, doubling the number of correct bits on
+	 * each iteration.  Any odd number is its own inverse modulo
+	 * 2^3, which provides the initial approximation.
+	 */
+	inverse = modulus;
+	for ( bits = 3 ; bits < ( 8 * sizeof ( inverse ) ) ; bits *= 2 )
+		inverse *= ( 2 - ( modulus * inverse ) );
+
+	return -inverse;
+}
+
+/**
+ * Perform Montgomery multiplication of big integers
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier0	Element 0 of big integer to be multiplied
+ * @v modulus0		Element 0 of big integer modulus (must be odd)
+ * @v modinv		Negated inverse of element 0 of modulus
+ * @v result0		Element 0 of big integer to hold result
+ * @v size		Number of elements in base, modulus, and result
+ * @v tmp		Temporary working space
+ *
+ * Calculates (a * b * R^{-1}) mod N, where R=2^{size*w} and w is the
+ * width of a big integer element.  The product of the multiplicand
+ * and multiplier must be less than R * N, which is guaranteed if
+ * either is already reduced modulo N.
+ */
+void bigint_montgomery_raw ( const bigint_element_t *multiplicand0,
+			     const bigint_element_t *multiplier0,
+			     const bigint_element_t *modulus0,
+			     bigint_element_t modinv,
+			     bigint_element_t *result0,
+			     unsigned int size, void *tmp ) {
+	const bigint_t ( size ) __attribute__ (( may_alias )) *modulus =
+		( ( const void * ) modulus0 );
+	bigint_t ( size ) __attribute__ (( may_alias )) *result =
+		( ( void * ) result0 );
+	struct {
+		bigint_t ( size * 2 + 1 ) product;
+	} *temp = tmp;
+	bigint_t ( size ) __attribute__ (( may_alias )) *high =
+		( ( void * ) &temp->product.element[size] );
+	bigint_element_t *element;
+	bigint_element_t factor;
+	bigint_element_t carry;
+	unsigned int i;
+
+	/* Sanity check */
+	assert ( sizeof ( *temp ) == bigint_montgomery_tmp_len ( modulus ) );
+
+	/* Perform multiplication */
+	bigint_multiply_raw ( multiplicand0, multiplier0,
+			      temp->product.element, size );
+	temp->product.element[ size * 2 ] = 0;
+
+	/* Add multiples of modulus to clear each low-order element */
+	for ( i = 0 ; i < size ; i++ ) {
+		element = &temp->product.element[i];
+		factor = ( *element * modinv );
+		carry = bigint_multiply_add_raw ( modulus0, factor, element,
+						  size );
+		for ( element += size ; carry ; element++ ) {
+			*element += carry;
+			carry = ( *element < carry );
+		}
+	}
+
+	/* Reduced product is less than twice the modulus */
+	if ( temp->product.element[ size * 2 ] ||
+	     bigint_is_geq ( high, modulus ) ) {
+		bigint_subtract ( modulus, high );
+	}
+
+	/* Copy out result */
+	memcpy ( result, high, sizeof ( *result ) );
+
+	/* Sanity check */
+	assert ( bigint_is_geq ( modulus, result ) );
+}
+
 /**
  * Perform modular exponentiation of big integers
  *
@@ -100,6 +198,10 @@ void bigint_mod_multiply_raw ( const bigint_element_t *multiplicand0,
  * @v size		Number of elements in base, modulus, and result
  * @v exponent_size	Number of elements in exponent
  * @v tmp		Temporary working space
+ *
+ * Odd moduli (including all RSA moduli) are handled using Montgomery
+ * multiplication.  Even moduli fall back to using modular
+ * multiplication with explicit reduction.
  */
 void bigint_mod_exp_raw ( const bigint_element_t *base0,
 			  const bigint_element_t *modulus0,
@@ -116,24 +218,115 @@ void bigint_mod_exp_raw ( const bigint_element_t *base0,
 	bigint_t ( size ) __attribute__ (( may_alias )) *result =
 		( ( void * ) result0 );
 	size_t mod_multiply_len = bigint_mod_multiply_tmp_len ( modulus );
+	size_t montgomery_len = bigint_montgomery_tmp_len ( modulus );
 	struct {
 		bigint_t ( size ) base;
 		bigint_t ( exponent_size ) exponent;
-		uint8_t mod_multiply[mod_multiply_len];
+		union {
+			uint8_t mod_multiply[mod_multiply_len];
+			struct {
+				bigint_t ( size + 1 ) square;
+				bigint_t ( size + 1 ) modulus;
+			} reduce;
+			struct {
+				bigint_t ( size ) one;
+				uint8_t montgomery[montgomery_len];
+			} montgomery;
+		} u;
 	} *temp = tmp;
 	static const uint8_t start[1] = { 0x01 };
+	unsigned int element_width = ( 8 * sizeof ( modulus->element[0] ) );
+	bigint_element_t modinv;
+	unsigned int width;
+	unsigned int max_bit;
+	unsigned int odd;
+	unsigned int squares;
+	unsigned int bit;
+
+	/* Sanity check */
+	assert ( sizeof ( *temp ) ==
+		 bigint_mod_exp_tmp_len ( modulus, exponent ) );
 
 	memcpy ( &temp->base, base, sizeof ( temp->base ) );
 	memcpy ( &temp->exponent, exponent, sizeof ( temp->exponent ) );
-	bigint_init ( result, start, sizeof ( start ) );
 
-	while ( ! bigint_is_zero ( &temp->exponent ) ) {
-		if ( bigint_bit_is_set ( &temp->exponent, 0 ) ) {
-			bigint_mod_multiply ( result, &temp->base, modulus,
-					      result, temp->mod_multiply );
+	/* Use explicit reduction for even moduli */
+	if ( ! bigint_bit_is_set ( modulus, 0 ) ) {
+		bigint_init ( result, start, sizeof ( start ) );
+		while ( ! bigint_is_zero ( &temp->exponent ) ) {
+			if ( bigint_bit_is_set ( &temp->exponent, 0 ) ) {
+				bigint_mod_multiply ( result, &temp->base,
+						      modulus, result,
+						      temp->u.mod_multiply );
+			}
+			bigint_ror ( &temp->exponent );
+			bigint_mod_multiply ( &temp->base, &temp->base,
+					      modulus, &temp->base,
+					      temp->u.mod_multiply );
 		}
-		bigint_ror ( &temp->exponent );
-		bigint_mod_multiply ( &temp->base, &temp->base, modulus,
-				      &temp->base, temp->mod_multiply );
+		return;
+	}
+
+	/* Calculate Montgomery inverse of modulus */
+	modinv = bigint_montgomery_inverse ( modulus );
+
+	/* Calculate R^2 mod N, where R=2^{width}.  We write the
+	 * width as (odd * 2^squares), construct the Montgomery form
+	 * of 2^{odd} (i.e. 2^{odd} * R mod N) by repeated doubling
+	 * from the largest power of two not exceeding the modulus,
+	 * and then square the Montgomery form to obtain the Montgomery
+	 * form of R (i.e. R^2 mod N).
+	 */
+	width = ( 8 * sizeof ( *modulus ) );
+	for ( odd = width, squares = 0 ; ! ( odd & 1 ) ; odd >>= 1 )
+		squares++;
+	max_bit = bigint_max_set_bit ( modulus );
+	bigint_grow ( modulus, &temp->u.reduce.modulus );
+	memset ( &temp->u.reduce.square, 0, sizeof ( temp->u.reduce.square ) );
+	bit = ( max_bit - 1 );
+	temp->u.reduce.square.element[ bit / element_width ] =
+		( ( ( bigint_element_t ) 1 ) << ( bit % element_width ) );
+	for ( ; ; bit++ ) {
+		if ( bigint_is_geq ( &temp->u.reduce.square,
+				     &temp->u.reduce.modulus ) ) {
+			bigint_subtract ( &temp->u.reduce.modulus,
+					  &temp->u.reduce.square );
+		}
+		if ( bit == ( width + odd ) )
+			break;
+		bigint_rol ( &temp->u.reduce.square );
+	}
+	bigint_shrink ( &temp->u.reduce.square, result );
+	while ( squares-- ) {
+		bigint_montgomery ( result, result, modulus, modinv, result,
+				    temp->u.montgomery.montgomery );
 	}
+
+	/* Convert base to Montgomery form, and initialise result to
+	 * the Montgomery form of one (i.e. R mod N).
+	 */
+	bigint_init ( &temp->u.montgomery.one, start, sizeof ( start ) );
+	bigint_montgomery ( &temp->base, result, modulus, modinv,
+			    &temp->base, temp->u.montgomery.montgomery );
+	bigint_montgomery ( result, &temp->u.montgomery.one, modulus, modinv,
+			    result, temp->u.montgomery.montgomery );
+
+	/* Perform exponentiation in Montgomery form */
+	max_bit = bigint_max_set_bit ( exponent );
+	for ( bit = 0 ; bit < max_bit ; bit++ ) {
+		if ( bigint_bit_is_set ( exponent, bit ) ) {
+			bigint_montgomery ( result, &temp->base, modulus,
+					    modinv, result,
+					    temp->u.montgomery.montgomery );
+		}
+		if ( ( bit + 1 ) < max_bit ) {
+			bigint_montgomery ( &temp->base, &temp->base,
+					    modulus, modinv, &temp->base,
+					    temp->u.montgomery.montgomery );
+		}
+	}
+
+	/* Convert result out of Montgomery form */
+	bigint_montgomery ( result, &temp->u.montgomery.one, modulus, modinv,
+			    result, temp->u.montgomery.montgomery );
 }
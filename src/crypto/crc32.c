@@ -21,10 +21,57 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <string.h>
+#include <byteswap.h>
 #include <ipxe/crc32.h>
 
+/** @file
+ *
+ * Little-endian CRC32
+ *
+ * The generic implementation uses the "slice-by-8" algorithm, which
+ * processes eight bytes at a time using eight 256-entry lookup
+ * tables.  The tables are constructed on first use, to avoid adding
+ * 8kB of read-only data to the binary.
+ */
+
 #define CRCPOLY		0xedb88320
 
+/** CRC32 lookup tables */
+static uint32_t crc32_table[8][256];
+
+/** CRC32 lookup tables have been constructed */
+static int crc32_table_ready;
+
+/**
+ * Construct CRC32 lookup tables
+ *
+ */
+static void crc32_init_table ( void ) {
+	uint32_t crc;
+	unsigned int i;
+	unsigned int j;
+
+	/* Construct single-byte table */
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = i;
+		for ( j = 0 ; j < 8 ; j++ )
+			crc = ( ( crc >> 1 ) ^ ( ( crc & 1 ) ? CRCPOLY : 0 ) );
+		crc32_table[0][i] = crc;
+	}
+
+	/* Construct tables for each subsequent byte position */
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = crc32_table[0][i];
+		for ( j = 1 ; j < 8 ; j++ ) {
+			crc = ( ( crc >> 8 ) ^ crc32_table[0][ crc & 0xff ] );
+			crc32_table[j][i] = crc;
+		}
+	}
+
+	crc32_table_ready = 1;
+}
+
 /**
  * Calculate 32-bit little-endian CRC checksum
  *
@@ -36,19 +83,39 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * protocol. To continue a CRC checksum over multiple calls, pass the
  * return value from one call as the @a seed parameter to the next.
  */
-u32 crc32_le ( u32 seed, const void *data, size_t len )
+u32 generic_crc32_le ( u32 seed, const void *data, size_t len )
 {
 	u32 crc = seed;
 	const u8 *src = data;
-	u32 mult;
-	int i;
+	u32 low;
+	u32 high;
+
+	/* Construct lookup tables, if not already done */
+	if ( ! crc32_table_ready )
+		crc32_init_table();
 
+	/* Process eight bytes at a time */
+	while ( len >= 8 ) {
+		memcpy ( &low, src, sizeof ( low ) );
+		memcpy ( &high, ( src + sizeof ( low ) ), sizeof ( high ) );
+		low = ( le32_to_cpu ( low ) ^ crc );
+		high = le32_to_cpu ( high );
+		crc = ( crc32_table[7][ ( low >> 0 ) & 0xff ] ^
+			crc32_table[6][ ( low >> 8 ) & 0xff ] ^
+			crc32_table[5][ ( low >> 16 ) & 0xff ] ^
+			crc32_table[4][ ( low >> 24 ) & 0xff ] ^
+			crc32_table[3][ ( high >> 0 ) & 0xff ] ^
+			crc32_table[2][ ( high >> 8 ) & 0xff ] ^
+			crc32_table[1][ ( high >> 16 ) & 0xff ] ^
+			crc32_table[0][ ( high >> 24 ) & 0xff ] );
+		src += 8;
+		len -= 8;
+	}
+
+	/* Process any remaining bytes */
 	while ( len-- ) {
-		crc ^= *src++;
-		for ( i = 0; i < 8; i++ ) {
-			mult = ( crc & 1 ) ? CRCPOLY : 0;
-			crc = ( crc >> 1 ) ^ mult;
-		}
+		crc = ( ( crc >> 8 ) ^
+			crc32_table[0][ ( crc ^ *(src++) ) & 0xff ] );
 	}
 
 	return crc;
@@ -19,6 +19,8 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <byteswap.h>
 #include <linux_api.h>
 #include <ipxe/list.h>
 #include <ipxe/linux.h>
@@ -29,6 +31,7 @@
 #include <ipxe/ethernet.h>
 #include <ipxe/settings.h>
 #include <ipxe/socket.h>
+#include <ipxe/tcpip.h>
 
 /* This hack prevents pre-2.6.32 headers from redefining struct sockaddr */
 #define __GLIBC__ 2
@@ -40,56 +43,181 @@
 
 #define RX_BUF_SIZE 1536
 
+/** Maximum number of tap queues */
+#define TAP_MAX_QUEUES 8
+
+/** Number of pre-allocated receive buffers */
+#define TAP_NUM_RX_BUFS 32
+
 /** @file
  *
  * The TAP driver.
  *
  * The TAP is a Virtual Ethernet network device.
+ *
+ * Frames are exchanged with the kernel prefixed by a virtio-net
+ * header (IFF_VNET_HDR).  This allows the kernel to hand us frames
+ * with a partial checksum (TUN_F_CSUM), saving the host from
+ * checksumming traffic that we will verify anyway.  Each frame is
+ * read directly into a pre-allocated I/O buffer using a single
+ * vectored read, and multiple queues (IFF_MULTI_QUEUE) may be
+ * serviced using a single call to poll().
  */
 
+/** A virtio-net header, as used by IFF_VNET_HDR */
+struct tap_vnet_hdr {
+	/** Flags */
+	uint8_t flags;
+	/** Segmentation offload type */
+	uint8_t gso_type;
+	/** Header length */
+	uint16_t hdr_len;
+	/** Segment size */
+	uint16_t gso_size;
+	/** Offset at which to start checksumming */
+	uint16_t csum_start;
+	/** Offset (from csum_start) at which to store checksum */
+	uint16_t csum_offset;
+} __attribute__ (( packed ));
+
+/** Checksum needs to be completed by the receiver */
+#define TAP_VNET_HDR_F_NEEDS_CSUM 0x01
+
+/** Tap packet statistics */
+struct tap_statistics {
+	/** Number of calls to poll() */
+	unsigned long polls;
+	/** Number of frames received */
+	unsigned long rx_frames;
+	/** Number of system calls used for reception */
+	unsigned long rx_syscalls;
+	/** Number of frames transmitted */
+	unsigned long tx_frames;
+	/** Number of system calls used for transmission */
+	unsigned long tx_syscalls;
+};
+
 struct tap_nic {
 	/** Tap interface name */
 	char * interface;
-	/** File descriptor of the opened tap device */
-	int fd;
+	/** Number of queues */
+	unsigned int num_queues;
+	/** File descriptors of the opened tap queues */
+	int fd[TAP_MAX_QUEUES];
+	/** Pool of pre-allocated receive buffers */
+	struct io_buffer *rx_iobuf[TAP_NUM_RX_BUFS];
+	/** Number of buffers in receive pool */
+	unsigned int rx_fill;
+	/** Packet statistics */
+	struct tap_statistics stats;
 };
 
-/** Open the TAP device */
-static int tap_open(struct net_device * netdev)
+/** Close all open TAP queues */
+static void tap_close_queues(struct tap_nic *nic, unsigned int count)
+{
+	while (count--)
+		linux_close(nic->fd[count]);
+}
+
+/** Open a single TAP queue */
+static int tap_open_queue(struct tap_nic *nic, unsigned int index)
 {
-	struct tap_nic * nic = netdev->priv;
 	struct ifreq ifr;
+	unsigned int offload;
+	int hdr_len;
+	int fd;
 	int ret;
 
-	nic->fd = linux_open("/dev/net/tun", O_RDWR);
-	if (nic->fd < 0) {
-		DBGC(nic, "tap %p open('/dev/net/tun') = %d (%s)\n", nic, nic->fd, linux_strerror(linux_errno));
-		return nic->fd;
+	fd = linux_open("/dev/net/tun", O_RDWR);
+	if (fd < 0) {
+		DBGC(nic, "tap %p open('/dev/net/tun') = %d (%s)\n", nic, fd, linux_strerror(linux_errno));
+		return fd;
 	}
 
 	memset(&ifr, 0, sizeof(ifr));
 	/* IFF_NO_PI for no extra packet information */
-	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	ifr.ifr_flags = IFF_TAP | IFF_NO_PI | IFF_VNET_HDR;
+	if (nic->num_queues > 1)
+		ifr.ifr_flags |= IFF_MULTI_QUEUE;
 	strncpy(ifr.ifr_name, nic->interface, IFNAMSIZ);
-	DBGC(nic, "tap %p interface = '%s'\n", nic, nic->interface);
+	DBGC(nic, "tap %p interface = '%s' queue %d\n", nic, nic->interface, index);
 
-	ret = linux_ioctl(nic->fd, TUNSETIFF, &ifr);
+	ret = linux_ioctl(fd, TUNSETIFF, &ifr);
 
 	if (ret != 0) {
-		DBGC(nic, "tap %p ioctl(%d, ...) = %d (%s)\n", nic, nic->fd, ret, linux_strerror(linux_errno));
-		linux_close(nic->fd);
-		return ret;
+		DBGC(nic, "tap %p ioctl(%d, ...) = %d (%s)\n", nic, fd, ret, linux_strerror(linux_errno));
+		goto err;
 	}
 
+	/* Use the basic virtio-net header (which is also the kernel's
+	 * default), and accept frames with a partial checksum.  If
+	 * the kernel refuses the offload then it will simply never
+	 * hand us such frames.
+	 */
+	hdr_len = sizeof(struct tap_vnet_hdr);
+	if (linux_ioctl(fd, TUNSETVNETHDRSZ, &hdr_len) != 0)
+		DBGC(nic, "tap %p could not set header size (%s)\n", nic, linux_strerror(linux_errno));
+	offload = TUN_F_CSUM;
+	if (linux_ioctl(fd, TUNSETOFFLOAD, offload) != 0)
+		DBGC(nic, "tap %p could not enable offloads (%s)\n", nic, linux_strerror(linux_errno));
+
 	/* Set nonblocking mode to make tap_poll easier */
-	ret = linux_fcntl(nic->fd, F_SETFL, O_NONBLOCK);
+	ret = linux_fcntl(fd, F_SETFL, O_NONBLOCK);
 
 	if (ret != 0) {
-		DBGC(nic, "tap %p fcntl(%d, ...) = %d (%s)\n", nic, nic->fd, ret, linux_strerror(linux_errno));
-		linux_close(nic->fd);
-		return ret;
+		DBGC(nic, "tap %p fcntl(%d, ...) = %d (%s)\n", nic, fd, ret, linux_strerror(linux_errno));
+		goto err;
 	}
 
+	nic->fd[index] = fd;
+	return 0;
+
+err:
+	linux_close(fd);
+	return ret;
+}
+
+/** Refill the receive buffer pool */
+static void tap_refill_rx(struct tap_nic *nic)
+{
+	struct io_buffer *iobuf;
+
+	while (nic->rx_fill < TAP_NUM_RX_BUFS) {
+		iobuf = alloc_iob(RX_BUF_SIZE);
+		if (! iobuf) {
+			DBGC(nic, "tap %p alloc_iob failed\n", nic);
+			return;
+		}
+		nic->rx_iobuf[nic->rx_fill++] = iobuf;
+	}
+}
+
+/** Empty the receive buffer pool */
+static void tap_empty_rx(struct tap_nic *nic)
+{
+	while (nic->rx_fill)
+		free_iob(nic->rx_iobuf[--nic->rx_fill]);
+}
+
+/** Open the TAP device */
+static int tap_open(struct net_device * netdev)
+{
+	struct tap_nic * nic = netdev->priv;
+	unsigned int i;
+	int ret;
+
+	/* Open queues */
+	for (i = 0; i < nic->num_queues; i++) {
+		if ((ret = tap_open_queue(nic, i)) != 0) {
+			tap_close_queues(nic, i);
+			return ret;
+		}
+	}
+
+	/* Pre-allocate receive buffers */
+	tap_refill_rx(nic);
+
+	memset(&nic->stats, 0, sizeof(nic->stats));
 	return 0;
 }
 
@@ -97,7 +225,13 @@ static int tap_open(struct net_device * netdev)
 static void tap_close(struct net_device *netdev)
 {
 	struct tap_nic * nic = netdev->priv;
-	linux_close(nic->fd);
+	struct tap_statistics *stats = &nic->stats;
+
+	DBGC(nic, "tap %p RX %ld frames in %ld reads (%ld polls), TX %ld frames in %ld writes\n",
+	     nic, stats->rx_frames, stats->rx_syscalls, stats->polls, stats->tx_frames, stats->tx_syscalls);
+
+	tap_close_queues(nic, nic->num_queues);
+	tap_empty_rx(nic);
 }
 
 /**
@@ -108,57 +242,120 @@ static void tap_close(struct net_device *netdev)
 static int tap_transmit(struct net_device *netdev, struct io_buffer *iobuf)
 {
 	struct tap_nic * nic = netdev->priv;
+	struct tap_vnet_hdr hdr;
+	struct iovec iov[2];
 	int rc;
 
 	/* Pad and align packet */
 	iob_pad(iobuf, ETH_ZLEN);
 
-	rc = linux_write(nic->fd, iobuf->data, iobuf->tail - iobuf->data);
+	/* Write header (requesting no offloads) and frame in one go */
+	memset(&hdr, 0, sizeof(hdr));
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = iobuf->data;
+	iov[1].iov_len = iob_len(iobuf);
+
+	rc = linux_writev(nic->fd[0], iov, 2);
+	nic->stats.tx_syscalls++;
 	DBGC2(nic, "tap %p wrote %d bytes\n", nic, rc);
+	if (rc > 0)
+		nic->stats.tx_frames++;
 	netdev_tx_complete(netdev, iobuf);
 
 	return 0;
 }
 
-/** Poll for new packets */
-static void tap_poll(struct net_device *netdev)
+/**
+ * Complete a partial checksum
+ *
+ * @v nic		Tap device
+ * @v hdr		virtio-net header
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+static int tap_complete_csum(struct tap_nic *nic, struct tap_vnet_hdr *hdr, struct io_buffer *iobuf)
+{
+	size_t start = le16_to_cpu(hdr->csum_start);
+	size_t offset = ( start + le16_to_cpu(hdr->csum_offset) );
+	uint16_t *csum;
+
+	if ((start > iob_len(iobuf)) || ((offset + sizeof(*csum)) > iob_len(iobuf))) {
+		DBGC(nic, "tap %p invalid checksum offsets %zd/%zd\n", nic, start, offset);
+		return -EINVAL;
+	}
+
+	/* The checksum field already contains the pseudo-header sum */
+	csum = (iobuf->data + offset);
+	*csum = tcpip_chksum((iobuf->data + start), (iob_len(iobuf) - start));
+
+	return 0;
+}
+
+/** Receive all pending packets from a TAP queue */
+static void tap_poll_queue(struct net_device *netdev, int fd)
 {
 	struct tap_nic * nic = netdev->priv;
-	struct pollfd pfd;
+	struct tap_vnet_hdr hdr;
 	struct io_buffer * iobuf;
+	struct iovec iov[2];
 	int r;
 
-	pfd.fd = nic->fd;
-	pfd.events = POLLIN;
-	if (linux_poll(&pfd, 1, 0) == -1) {
-		DBGC(nic, "tap %p poll failed (%s)\n", nic, linux_strerror(linux_errno));
-		return;
-	}
-	if ((pfd.revents & POLLIN) == 0)
-		return;
-
-	/* At this point we know there is at least one new packet to be read */
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
 
-	iobuf = alloc_iob(RX_BUF_SIZE);
-	if (! iobuf)
-		goto allocfail;
+	while (nic->rx_fill) {
 
-	while ((r = linux_read(nic->fd, iobuf->data, RX_BUF_SIZE)) > 0) {
+		/* Read header and frame directly into pool buffer */
+		iobuf = nic->rx_iobuf[nic->rx_fill - 1];
+		iov[1].iov_base = iobuf->data;
+		iov[1].iov_len = RX_BUF_SIZE;
+		r = linux_readv(fd, iov, 2);
+		nic->stats.rx_syscalls++;
+		if (r <= (int) sizeof(hdr))
+			return;
 		DBGC2(nic, "tap %p read %d bytes\n", nic, r);
 
-		iob_put(iobuf, r);
+		/* Hand buffer to network stack */
+		nic->rx_fill--;
+		nic->stats.rx_frames++;
+		iob_put(iobuf, (r - sizeof(hdr)));
+		if ((hdr.flags & TAP_VNET_HDR_F_NEEDS_CSUM) &&
+		    (tap_complete_csum(nic, &hdr, iobuf) != 0)) {
+			netdev_rx_err(netdev, iobuf, -EINVAL);
+			continue;
+		}
 		netdev_rx(netdev, iobuf);
+	}
+}
 
-		iobuf = alloc_iob(RX_BUF_SIZE);
-		if (! iobuf)
-			goto allocfail;
+/** Poll for new packets */
+static void tap_poll(struct net_device *netdev)
+{
+	struct tap_nic * nic = netdev->priv;
+	struct pollfd pfd[TAP_MAX_QUEUES];
+	unsigned int i;
+
+	/* Check all queues using a single system call */
+	for (i = 0; i < nic->num_queues; i++) {
+		pfd[i].fd = nic->fd[i];
+		pfd[i].events = POLLIN;
+		pfd[i].revents = 0;
 	}
+	if (linux_poll(pfd, nic->num_queues, 0) == -1) {
+		DBGC(nic, "tap %p poll failed (%s)\n", nic, linux_strerror(linux_errno));
+		return;
+	}
+	nic->stats.polls++;
 
-	free_iob(iobuf);
-	return;
+	/* Drain each queue with new packets */
+	for (i = 0; i < nic->num_queues; i++) {
+		if (pfd[i].revents & POLLIN)
+			tap_poll_queue(netdev, pfd[i].fd);
+	}
 
-allocfail:
-	DBGC(nic, "tap %p alloc_iob failed\n", nic);
+	/* Replenish receive buffer pool */
+	tap_refill_rx(nic);
 }
 
 /**
@@ -186,6 +383,7 @@ static struct net_device_operations tap_operations = {
 static int tap_probe(struct linux_device *device, struct linux_device_request *request)
 {
 	struct linux_setting *if_setting;
+	struct linux_setting *queues_setting;
 	struct net_device *netdev;
 	struct tap_nic *nic;
 	int rc;
@@ -211,10 +409,24 @@ static int tap_probe(struct linux_device *device, struct linux_device_request *r
 	}
 
 	nic->interface = if_setting->value;
+	if_setting->applied = 1;
+
+	/* Look for the optional queues setting */
+	nic->num_queues = 1;
+	queues_setting = linux_find_setting("queues", &request->settings);
+	if (queues_setting) {
+		nic->num_queues = strtoul(queues_setting->value, NULL, 0);
+		if ((nic->num_queues < 1) || (nic->num_queues > TAP_MAX_QUEUES)) {
+			printf("tap queues must be between 1 and %d\n", TAP_MAX_QUEUES);
+			rc = -EINVAL;
+			goto err_settings;
+		}
+		queues_setting->applied = 1;
+	}
+
 	snprintf ( device->dev.name, sizeof ( device->dev.name ), "%s",
 		   nic->interface );
 	device->dev.desc.bus_type = BUS_TYPE_TAP;
-	if_setting->applied = 1;
 
 	/* Apply rest of the settings */
 	linux_apply_settings(&request->settings, &netdev->settings.settings);
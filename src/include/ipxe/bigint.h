@@ -221,6 +221,46 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 		bigint_t ( size * 2 ) temp_modulus;			\
 	} ); } )
 
+/**
+ * Calculate Montgomery inverse of big integer modulus
+ *
+ * @v modulus		Big integer modulus (must be odd)
+ * @ret modinv		Negated inverse of element 0 of modulus
+ */
+#define bigint_montgomery_inverse( modulus ) ( {			\
+	bigint_montgomery_inverse_raw ( (modulus)->element ); } )
+
+/**
+ * Perform Montgomery multiplication of big integers
+ *
+ * @v multiplicand	Big integer to be multiplied
+ * @v multiplier	Big integer to be multiplied
+ * @v modulus		Big integer modulus (must be odd)
+ * @v modinv		Negated inverse of element 0 of modulus
+ * @v result		Big integer to hold result
+ * @v tmp		Temporary working space
+ */
+#define bigint_montgomery( multiplicand, multiplier, modulus, modinv,	\
+			   result, tmp ) do {				\
+	unsigned int size = bigint_size (multiplicand);			\
+	bigint_montgomery_raw ( (multiplicand)->element,		\
+				(multiplier)->element,			\
+				(modulus)->element, (modinv),		\
+				(result)->element, size, tmp );		\
+	} while ( 0 )
+
+/**
+ * Calculate temporary working space required for Montgomery multiplication
+ *
+ * @v modulus		Big integer modulus
+ * @ret len		Length of temporary working space
+ */
+#define bigint_montgomery_tmp_len( modulus ) ( {			\
+	unsigned int size = bigint_size (modulus);			\
+	sizeof ( struct {						\
+		bigint_t ( size * 2 + 1 ) temp_product;			\
+	} ); } )
+
 /**
  * Perform modular exponentiation of big integers
  *
@@ -250,10 +290,22 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 	unsigned int exponent_size = bigint_size (exponent);		\
 	size_t mod_multiply_len =					\
 		bigint_mod_multiply_tmp_len (modulus);			\
+	size_t montgomery_len =						\
+		bigint_montgomery_tmp_len (modulus);			\
 	sizeof ( struct {						\
 		bigint_t ( size ) temp_base;				\
 		bigint_t ( exponent_size ) temp_exponent;		\
-		uint8_t mod_multiply[mod_multiply_len];			\
+		union {							\
+			uint8_t mod_multiply[mod_multiply_len];		\
+			struct {					\
+				bigint_t ( size + 1 ) temp_square;	\
+				bigint_t ( size + 1 ) temp_modulus;	\
+			} reduce;					\
+			struct {					\
+				bigint_t ( size ) temp_one;		\
+				uint8_t montgomery[montgomery_len];	\
+			} montgomery;					\
+		} u;							\
 	} ); } )
 
 #include <bits/bigint.h>
@@ -291,6 +343,14 @@ void bigint_mod_multiply_raw ( const bigint_element_t *multiplicand0,
 			       const bigint_element_t *modulus0,
 			       bigint_element_t *result0,
 			       unsigned int size, void *tmp );
+bigint_element_t
+bigint_montgomery_inverse_raw ( const bigint_element_t *modulus0 );
+void bigint_montgomery_raw ( const bigint_element_t *multiplicand0,
+			     const bigint_element_t *multiplier0,
+			     const bigint_element_t *modulus0,
+			     bigint_element_t modinv,
+			     bigint_element_t *result0,
+			     unsigned int size, void *tmp );
 void bigint_mod_exp_raw ( const bigint_element_t *base0,
 			  const bigint_element_t *modulus0,
 			  const bigint_element_t *exponent0,
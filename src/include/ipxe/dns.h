@@ -11,6 +11,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 #include <ipxe/in.h>
+#include <ipxe/list.h>
 
 /** DNS server port */
 #define DNS_PORT 53
@@ -146,10 +147,75 @@ union dns_rr {
 	struct dns_rr_cname cname;
 };
 
+/** Maximum number of entries in the DNS cache
+ *
+ * This is a policy decision.
+ */
+#define DNS_CACHE_MAX_ENTRIES 32
+
+/** Maximum time for which a DNS answer will be cached (in seconds)
+ *
+ * This is a policy decision.  Servers may advertise TTLs of several
+ * days; there is no point in trusting an answer for longer than a
+ * typical boot will take.
+ */
+#define DNS_CACHE_MAX_TTL 3600
+
+/** Time for which a nonexistent name will be cached (in seconds)
+ *
+ * This is a policy decision.  RFC2308 would have us use the minimum
+ * TTL from the SOA record in the authority section, which we do not
+ * parse.
+ */
+#define DNS_CACHE_NEGATIVE_TTL 60
+
+/** A DNS cache entry */
+struct dns_cache_entry {
+	/** List of DNS cache entries */
+	struct list_head list;
+	/** Time at which entry was created (in ticks) */
+	unsigned long created;
+	/** Lifetime of entry (in ticks) */
+	unsigned long timeout;
+	/** Result of resolution (zero for a positive entry) */
+	int rc;
+	/** Address family of resolved address */
+	sa_family_t family;
+	/** Resolved address */
+	union {
+		/** IPv4 address */
+		struct in_addr in;
+		/** IPv6 address */
+		struct in6_addr in6;
+	} address;
+	/** Name (as passed to the resolver) */
+	char name[0];
+};
+
+/** DNS cache statistics */
+struct dns_cache_statistics {
+	/** Number of lookups satisfied by a positive cache entry */
+	unsigned long hits;
+	/** Number of lookups satisfied by a negative cache entry */
+	unsigned long negative_hits;
+	/** Number of lookups not satisfied by the cache */
+	unsigned long misses;
+	/** Number of entries added to the cache */
+	unsigned long insertions;
+	/** Number of entries removed due to TTL expiry */
+	unsigned long expirations;
+	/** Number of entries removed due to space limits */
+	unsigned long evictions;
+};
+
+extern struct list_head dns_cache;
+extern struct dns_cache_statistics dns_cache_stats;
+
 extern int dns_encode ( const char *string, struct dns_name *name );
 extern int dns_decode ( struct dns_name *name, char *data, size_t len );
 extern int dns_compare ( struct dns_name *first, struct dns_name *second );
 extern int dns_copy ( struct dns_name *src, struct dns_name *dst );
 extern int dns_skip ( struct dns_name *name );
+extern unsigned long dns_cache_remaining ( struct dns_cache_entry *entry );
 
 #endif /* _IPXE_DNS_H */
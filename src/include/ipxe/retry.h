@@ -17,9 +17,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Default maximum timeout value (in ticks) */
 #define DEFAULT_MAX_TIMEOUT ( 10 * TICKS_PER_SEC )
 
+/** Time remaining until next timer expiry when no timers are running */
+#define RETRY_IDLE ( ~0UL )
+
 /** A retry timer */
 struct retry_timer {
-	/** List of active timers */
+	/** List of active timers (ordered by expiry time) */
 	struct list_head list;
 	/** Timer is currently running */
 	unsigned int running;
@@ -88,6 +91,7 @@ extern void start_timer_fixed ( struct retry_timer *timer,
 				unsigned long timeout );
 extern void stop_timer ( struct retry_timer *timer );
 extern void retry_poll ( void );
+extern unsigned long retry_remaining ( void );
 
 /**
  * Start timer with no delay
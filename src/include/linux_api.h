@@ -44,6 +44,7 @@ typedef __kernel_loff_t loff_t;
 #include <linux/fcntl.h>
 #include <linux/ioctl.h>
 #include <linux/poll.h>
+#include <linux/uio.h>
 typedef unsigned long nfds_t;
 typedef uint32_t useconds_t;
 #define MAP_FAILED ( ( void * ) -1 )
@@ -57,6 +58,10 @@ extern off_t linux_lseek ( int fd, off_t offset, int whence );
 extern __kernel_ssize_t linux_read ( int fd, void *buf, __kernel_size_t count );
 extern __kernel_ssize_t linux_write ( int fd, const void *buf,
 				      __kernel_size_t count );
+extern __kernel_ssize_t linux_readv ( int fd, const struct iovec *iov,
+				      int iovcnt );
+extern __kernel_ssize_t linux_writev ( int fd, const struct iovec *iov,
+				       int iovcnt );
 extern int linux_fcntl ( int fd, int cmd, ... );
 extern int linux_ioctl ( int fd, int request, ... );
 extern int linux_poll ( struct pollfd *fds, nfds_t nfds, int timeout );
@@ -0,0 +1,14 @@
+#ifndef _USR_DNSMGMT_H
+#define _USR_DNSMGMT_H
+
+/** @file
+ *
+ * DNS management
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern void dnsstat ( void );
+
+#endif /* _USR_DNSMGMT_H */
@@ -39,6 +39,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  * This implementation of the timer is designed to satisfy RFC 2988
  * and therefore be usable as a TCP retransmission timer.
+ *
+ * Running timers are kept in a list ordered by expiry time, so that
+ * polling needs to examine only the timers that have actually
+ * expired (plus the first unexpired timer).
  * 
  */
 
@@ -48,9 +52,19 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 #define MIN_TIMEOUT 7
 
-/** List of running timers */
+/** List of running timers, in order of expiry time */
 static LIST_HEAD ( timers );
 
+/**
+ * Calculate timer expiry time
+ *
+ * @v timer		Retry timer
+ * @ret expiry		Expiry time (in ticks)
+ */
+static inline unsigned long timer_expiry ( struct retry_timer *timer ) {
+	return ( timer->start + timer->timeout );
+}
+
 /**
  * Start timer with a specified timeout
  *
@@ -62,10 +76,15 @@ static LIST_HEAD ( timers );
  * be stopped and the timer's callback function will be called.
  */
 void start_timer_fixed ( struct retry_timer *timer, unsigned long timeout ) {
+	struct retry_timer *before;
+	unsigned long expiry;
 
-	/* Add to list of running timers (if applicable) */
-	if ( ! timer->running ) {
-		list_add ( &timer->list, &timers );
+	/* Remove from list of running timers (if applicable), since
+	 * the expiry time (and hence the list position) will change.
+	 */
+	if ( timer->running ) {
+		list_del ( &timer->list );
+	} else {
 		ref_get ( timer->refcnt );
 		timer->running = 1;
 	}
@@ -76,6 +95,19 @@ void start_timer_fixed ( struct retry_timer *timer, unsigned long timeout ) {
 	/* Record timeout */
 	timer->timeout = timeout;
 
+	/* Insert into list of running timers in order of expiry
+	 * time.  Search backwards from the latest expiry time, since
+	 * a newly started timer will usually expire after most of the
+	 * existing timers.  Timers with equal expiry times will
+	 * expire in the order in which they were started.
+	 */
+	expiry = timer_expiry ( timer );
+	list_for_each_entry_reverse ( before, &timers, list ) {
+		if ( ( signed long ) ( expiry - timer_expiry ( before ) ) >= 0 )
+			break;
+	}
+	list_add ( &timer->list, &before->list );
+
 	DBGC2 ( timer, "Timer %p started at time %ld (expires at %ld)\n",
 		timer, timer->start, ( timer->start + timer->timeout ) );
 }
@@ -196,23 +228,51 @@ static void timer_expired ( struct retry_timer *timer ) {
  */
 void retry_poll ( void ) {
 	struct retry_timer *timer;
+	struct list_head *last = &timers;
 	unsigned long now = currticks();
-	unsigned long used;
+	LIST_HEAD ( expired );
 
-	/* Process at most one timer expiry.  We cannot process
-	 * multiple expiries in one pass, because one timer expiring
-	 * may end up triggering another timer's deletion from the
-	 * list.
+	/* Collect all expired timers.  Since the list is ordered by
+	 * expiry time, we can stop at the first unexpired timer.
 	 */
 	list_for_each_entry ( timer, &timers, list ) {
-		used = ( now - timer->start );
-		if ( used >= timer->timeout ) {
-			timer_expired ( timer );
+		if ( ( now - timer->start ) < timer->timeout )
 			break;
-		}
+		last = &timer->list;
+	}
+	list_cut_position ( &expired, &timers, last );
+
+	/* Process all expired timers.  One timer expiring may end up
+	 * stopping or restarting another expired timer, which will
+	 * remove that timer from the list of expired timers.  We
+	 * must therefore always process the first remaining entry.
+	 */
+	while ( ( timer = list_first_entry ( &expired, struct retry_timer,
+					     list ) ) != NULL ) {
+		timer_expired ( timer );
 	}
 }
 
+/**
+ * Calculate time remaining until next timer expiry
+ *
+ * @ret remaining	Time remaining (in ticks), or RETRY_IDLE if idle
+ *
+ * This may be used by idle loops to determine how long they may
+ * sleep without delaying any timer expiry.
+ */
+unsigned long retry_remaining ( void ) {
+	struct retry_timer *timer;
+	unsigned long used;
+
+	/* Check first (i.e. earliest expiring) running timer */
+	timer = list_first_entry ( &timers, struct retry_timer, list );
+	if ( ! timer )
+		return RETRY_IDLE;
+	used = ( currticks() - timer->start );
+	return ( ( used < timer->timeout ) ? ( timer->timeout - used ) : 0 );
+}
+
 /**
  * Single-step the retry timer list
  *
@@ -29,6 +29,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
@@ -39,6 +40,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/open.h>
 #include <ipxe/resolv.h>
 #include <ipxe/retry.h>
+#include <ipxe/process.h>
+#include <ipxe/timer.h>
+#include <ipxe/malloc.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/settings.h>
 #include <ipxe/features.h>
@@ -435,6 +439,194 @@ static const char * dns_type ( uint16_t type ) {
 	}
 }
 
+/******************************************************************************
+ *
+ * Cache
+ *
+ ******************************************************************************
+ */
+
+/** DNS cache (most recently used first) */
+struct list_head dns_cache = LIST_HEAD_INIT ( dns_cache );
+
+/** DNS cache statistics */
+struct dns_cache_statistics dns_cache_stats;
+
+/** Number of entries in DNS cache */
+static unsigned int dns_cache_count;
+
+/**
+ * Get remaining lifetime of DNS cache entry
+ *
+ * @v entry		DNS cache entry
+ * @ret remaining	Remaining lifetime (in ticks), or zero if expired
+ */
+unsigned long dns_cache_remaining ( struct dns_cache_entry *entry ) {
+	unsigned long elapsed = ( currticks() - entry->created );
+
+	return ( ( elapsed < entry->timeout ) ?
+		 ( entry->timeout - elapsed ) : 0 );
+}
+
+/**
+ * Remove DNS cache entry
+ *
+ * @v entry		DNS cache entry
+ */
+static void dns_cache_del ( struct dns_cache_entry *entry ) {
+
+	list_del ( &entry->list );
+	dns_cache_count--;
+	free ( entry );
+}
+
+/**
+ * Flush DNS cache
+ *
+ */
+static void dns_cache_flush ( void ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list )
+		dns_cache_del ( entry );
+}
+
+/**
+ * Find DNS cache entry
+ *
+ * @v name		Name to resolve
+ * @ret entry		DNS cache entry, or NULL if not found
+ *
+ * Any expired entries encountered along the way will be removed.
+ */
+static struct dns_cache_entry * dns_cache_find ( const char *name ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list ) {
+
+		/* Remove expired entries */
+		if ( ! dns_cache_remaining ( entry ) ) {
+			DBG ( "DNS cache entry for \"%s\" expired\n",
+			      entry->name );
+			dns_cache_del ( entry );
+			dns_cache_stats.expirations++;
+			continue;
+		}
+
+		/* Check for a matching name */
+		if ( strcasecmp ( entry->name, name ) != 0 )
+			continue;
+
+		/* Move to start of list */
+		list_del ( &entry->list );
+		list_add ( &entry->list, &dns_cache );
+		return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * Add DNS cache entry
+ *
+ * @v name		Name that was resolved
+ * @v sa		Resolved socket address, or NULL for a negative entry
+ * @v rc		Result of resolution
+ * @v ttl		Time to live (in seconds)
+ */
+static void dns_cache_add ( const char *name, struct sockaddr *sa, int rc,
+			    unsigned long ttl ) {
+	struct sockaddr_in *sin = ( ( struct sockaddr_in * ) sa );
+	struct sockaddr_in6 *sin6 = ( ( struct sockaddr_in6 * ) sa );
+	struct dns_cache_entry *entry;
+	size_t name_len;
+
+	/* Do not cache answers that may not be cached */
+	if ( ! ttl )
+		return;
+	if ( ttl > DNS_CACHE_MAX_TTL )
+		ttl = DNS_CACHE_MAX_TTL;
+
+	/* Remove any existing entry for this name */
+	entry = dns_cache_find ( name );
+	if ( entry )
+		dns_cache_del ( entry );
+
+	/* Make room by evicting the least recently used entry, if needed */
+	if ( dns_cache_count >= DNS_CACHE_MAX_ENTRIES ) {
+		entry = list_last_entry ( &dns_cache, struct dns_cache_entry,
+					  list );
+		assert ( entry != NULL );
+		DBG ( "DNS cache evicting \"%s\"\n", entry->name );
+		dns_cache_del ( entry );
+		dns_cache_stats.evictions++;
+	}
+
+	/* Allocate and populate entry */
+	name_len = ( strlen ( name ) + 1 /* NUL */ );
+	entry = zalloc ( sizeof ( *entry ) + name_len );
+	if ( ! entry )
+		return;
+	entry->created = currticks();
+	entry->timeout = ( ttl * TICKS_PER_SEC );
+	entry->rc = rc;
+	if ( sa ) {
+		entry->family = sa->sa_family;
+		if ( sa->sa_family == AF_INET6 ) {
+			memcpy ( &entry->address.in6, &sin6->sin6_addr,
+				 sizeof ( entry->address.in6 ) );
+		} else {
+			entry->address.in = sin->sin_addr;
+		}
+	}
+	memcpy ( entry->name, name, name_len );
+
+	/* Add to start of cache */
+	list_add ( &entry->list, &dns_cache );
+	dns_cache_count++;
+	dns_cache_stats.insertions++;
+	DBG ( "DNS cache added \"%s\" (%s) for %lds\n", name,
+	      ( sa ? sock_ntoa ( sa ) : strerror ( rc ) ), ttl );
+}
+
+/**
+ * Discard some cached DNS entries
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int dns_cache_discard ( void ) {
+	struct dns_cache_entry *entry;
+
+	/* Drop least recently used cache entry, if any */
+	entry = list_last_entry ( &dns_cache, struct dns_cache_entry, list );
+	if ( entry ) {
+		dns_cache_del ( entry );
+		dns_cache_stats.evictions++;
+		return 1;
+	} else {
+		return 0;
+	}
+}
+
+/**
+ * DNS cache discarder
+ *
+ * DNS cache entries are cheap to replace: the worst case is a
+ * repeated query to the DNS server.
+ */
+struct cache_discarder dns_cache_discarder __cache_discarder ( CACHE_CHEAP ) = {
+	.discard = dns_cache_discard,
+};
+
+/******************************************************************************
+ *
+ * Resolver
+ *
+ ******************************************************************************
+ */
+
 /** A DNS request */
 struct dns_request {
 	/** Reference counter */
@@ -445,6 +637,8 @@ struct dns_request {
 	struct interface socket;
 	/** Retry timer */
 	struct retry_timer timer;
+	/** Process (used to return cached results) */
+	struct process process;
 
 	/** Socket address to fill in with resolved address */
 	union {
@@ -475,6 +669,12 @@ struct dns_request {
 	struct dns_name search;
 	/** Recursion counter */
 	unsigned int recursion;
+	/** Minimum TTL of all answers used so far (in seconds) */
+	unsigned long ttl;
+	/** Result of resolution (for cached results) */
+	int rc;
+	/** Name to be resolved (used as the cache key) */
+	char *key;
 };
 
 /**
@@ -485,8 +685,9 @@ struct dns_request {
  */
 static void dns_done ( struct dns_request *dns, int rc ) {
 
-	/* Stop the retry timer */
+	/* Stop the retry timer and process */
 	stop_timer ( &dns->timer );
+	process_del ( &dns->process );
 
 	/* Shut down interfaces */
 	intf_shutdown ( &dns->socket, rc );
@@ -504,6 +705,9 @@ static void dns_resolved ( struct dns_request *dns ) {
 	DBGC ( dns, "DNS %p found address %s\n",
 	       dns, sock_ntoa ( &dns->address.sa ) );
 
+	/* Add to cache */
+	dns_cache_add ( dns->key, &dns->address.sa, 0, dns->ttl );
+
 	/* Return resolved address */
 	resolv_done ( &dns->resolv, &dns->address.sa );
 
@@ -511,6 +715,19 @@ static void dns_resolved ( struct dns_request *dns ) {
 	dns_done ( dns, 0 );
 }
 
+/**
+ * Update minimum TTL of answers used for DNS request
+ *
+ * @v dns		DNS request
+ * @v rr		Resource record
+ */
+static void dns_update_ttl ( struct dns_request *dns, union dns_rr *rr ) {
+	unsigned long ttl = ntohl ( rr->common.ttl );
+
+	if ( ttl < dns->ttl )
+		dns->ttl = ttl;
+}
+
 /**
  * Construct DNS question
  *
@@ -722,6 +939,7 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			memcpy ( &dns->address.sin6.sin6_addr,
 				 &rr->aaaa.in6_addr,
 				 sizeof ( dns->address.sin6.sin6_addr ) );
+			dns_update_ttl ( dns, rr );
 			dns_resolved ( dns );
 			rc = 0;
 			goto done;
@@ -737,6 +955,7 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			}
 			dns->address.sin.sin_family = AF_INET;
 			dns->address.sin.sin_addr = rr->a.in_addr;
+			dns_update_ttl ( dns, rr );
 			dns_resolved ( dns );
 			rc = 0;
 			goto done;
@@ -756,6 +975,7 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			buf.offset = ( offset + sizeof ( rr->cname ) );
 			DBGC ( dns, "DNS %p found CNAME %s\n",
 			       dns, dns_name ( &buf ) );
+			dns_update_ttl ( dns, rr );
 			dns->search.offset = dns->search.len;
 			name_len = dns_copy ( &buf, &dns->name );
 			dns->offset = ( offsetof ( typeof ( dns->buf ), name ) +
@@ -823,6 +1043,9 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 		if ( dns->search.offset == dns->search.len ) {
 			DBGC ( dns, "DNS %p found no CNAME record\n", dns );
 			rc = -ENXIO_NO_RECORD;
+			if ( dns->ttl > DNS_CACHE_NEGATIVE_TTL )
+				dns->ttl = DNS_CACHE_NEGATIVE_TTL;
+			dns_cache_add ( dns->key, NULL, rc, dns->ttl );
 			dns_done ( dns, rc );
 			goto done;
 		}
@@ -877,6 +1100,28 @@ static struct interface_operation dns_socket_operations[] = {
 static struct interface_descriptor dns_socket_desc =
 	INTF_DESC ( struct dns_request, socket, dns_socket_operations );
 
+/**
+ * Return cached DNS result
+ *
+ * @v dns		DNS request
+ */
+static void dns_step ( struct dns_request *dns ) {
+
+	if ( dns->rc == 0 ) {
+		DBGC ( dns, "DNS %p found cached address %s\n",
+		       dns, sock_ntoa ( &dns->address.sa ) );
+		resolv_done ( &dns->resolv, &dns->address.sa );
+	} else {
+		DBGC ( dns, "DNS %p found cached failure: %s\n",
+		       dns, strerror ( dns->rc ) );
+	}
+	dns_done ( dns, dns->rc );
+}
+
+/** DNS process descriptor */
+static struct process_descriptor dns_process_desc =
+	PROC_DESC_ONCE ( struct dns_request, process, dns_step );
+
 /** DNS resolver interface operations */
 static struct interface_operation dns_resolv_op[] = {
 	INTF_OP ( intf_close, struct dns_request *, dns_done ),
@@ -898,7 +1143,9 @@ static int dns_resolv ( struct interface *resolv,
 			const char *name, struct sockaddr *sa ) {
 	struct dns_request *dns;
 	struct dns_header *query;
+	struct dns_cache_entry *entry;
 	size_t search_len;
+	size_t key_len;
 	int name_len;
 	int rc;
 
@@ -914,7 +1161,8 @@ static int dns_resolv ( struct interface *resolv,
 	search_len = ( strchr ( name, '.' ) ? 0 : dns_search.len );
 
 	/* Allocate DNS structure */
-	dns = zalloc ( sizeof ( *dns ) + search_len );
+	key_len = ( strlen ( name ) + 1 /* NUL */ );
+	dns = zalloc ( sizeof ( *dns ) + search_len + key_len );
 	if ( ! dns ) {
 		rc = -ENOMEM;
 		goto err_alloc_dns;
@@ -923,10 +1171,39 @@ static int dns_resolv ( struct interface *resolv,
 	intf_init ( &dns->resolv, &dns_resolv_desc, &dns->refcnt );
 	intf_init ( &dns->socket, &dns_socket_desc, &dns->refcnt );
 	timer_init ( &dns->timer, dns_timer_expired, &dns->refcnt );
+	process_init_stopped ( &dns->process, &dns_process_desc,
+			       &dns->refcnt );
 	memcpy ( &dns->address.sa, sa, sizeof ( dns->address.sa ) );
 	dns->search.data = ( ( ( void * ) dns ) + sizeof ( *dns ) );
 	dns->search.len = search_len;
 	memcpy ( dns->search.data, dns_search.data, search_len );
+	dns->key = ( dns->search.data + search_len );
+	memcpy ( dns->key, name, key_len );
+	dns->ttl = DNS_CACHE_MAX_TTL;
+
+	/* Use cached result, if available */
+	entry = dns_cache_find ( name );
+	if ( entry ) {
+		dns->rc = entry->rc;
+		if ( entry->rc == 0 ) {
+			dns_cache_stats.hits++;
+			dns->address.sa.sa_family = entry->family;
+			if ( entry->family == AF_INET6 ) {
+				memcpy ( &dns->address.sin6.sin6_addr,
+					 &entry->address.in6,
+					 sizeof ( entry->address.in6 ) );
+			} else {
+				dns->address.sin.sin_addr = entry->address.in;
+			}
+		} else {
+			dns_cache_stats.negative_hits++;
+		}
+		process_add ( &dns->process );
+		intf_plug_plug ( &dns->resolv, resolv );
+		ref_put ( &dns->refcnt );
+		return 0;
+	}
+	dns_cache_stats.misses++;
 
 	/* Determine initial query type */
 	switch ( nameserver.sa.sa_family ) {
@@ -1114,6 +1391,13 @@ static void apply_dns_search ( void ) {
  * @ret rc		Return status code
  */
 static int apply_dns_settings ( void ) {
+	typeof ( nameserver ) old_nameserver;
+	struct dns_name old_search;
+
+	/* Record existing configuration */
+	memcpy ( &old_nameserver, &nameserver, sizeof ( old_nameserver ) );
+	memcpy ( &old_search, &dns_search, sizeof ( old_search ) );
+	memset ( &dns_search, 0, sizeof ( dns_search ) );
 
 	/* Fetch DNS server address */
 	nameserver.sa.sa_family = 0;
@@ -1147,6 +1431,17 @@ static int apply_dns_settings ( void ) {
 		DBG ( "\n" );
 	}
 
+	/* Discard cached answers if the configuration has changed */
+	if ( ( memcmp ( &old_nameserver, &nameserver,
+			sizeof ( old_nameserver ) ) != 0 ) ||
+	     ( old_search.len != dns_search.len ) ||
+	     ( memcmp ( old_search.data, dns_search.data,
+			dns_search.len ) != 0 ) ) {
+		DBG ( "DNS configuration changed; flushing cache\n" );
+		dns_cache_flush();
+	}
+	free ( old_search.data );
+
 	return 0;
 }
 
@@ -556,6 +556,7 @@ int create_validator ( struct interface *job, struct x509_chain *chain ) {
 		    &validator->refcnt );
 	process_init ( &validator->process, &validator_process_desc,
 		       &validator->refcnt );
+	xferbuf_malloc_init ( &validator->buffer );
 	validator->chain = x509_chain_get ( chain );
 
 	/* Attach parent interface, mortalise self, and return */
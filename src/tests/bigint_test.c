@@ -33,13 +33,21 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #undef NDEBUG
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ipxe/bigint.h>
 #include <ipxe/test.h>
+#include <ipxe/profile.h>
 
 /** Define inline big integer */
 #define BIGINT(...) { __VA_ARGS__ }
 
+/** Number of sample iterations for profiling */
+#define PROFILE_COUNT 16
+
+/** Number of elements in profiled big integers (2048-bit RSA modulus) */
+#define PROFILE_SIZE bigint_required_size ( 2048 / 8 )
+
 /* Provide global functions to allow inspection of generated assembly code */
 
 void bigint_init_sample ( bigint_element_t *value0, unsigned int size,
@@ -181,6 +189,25 @@ void bigint_mod_multiply_sample ( const bigint_element_t *multiplicand0,
 	bigint_mod_multiply ( multiplicand, multiplier, modulus, result, tmp );
 }
 
+void bigint_montgomery_sample ( const bigint_element_t *multiplicand0,
+				const bigint_element_t *multiplier0,
+				const bigint_element_t *modulus0,
+				bigint_element_t modinv,
+				bigint_element_t *result0,
+				unsigned int size, void *tmp ) {
+	const bigint_t ( size ) *multiplicand __attribute__ (( may_alias ))
+		= ( ( const void * ) multiplicand0 );
+	const bigint_t ( size ) *multiplier __attribute__ (( may_alias ))
+		= ( ( const void * ) multiplier0 );
+	const bigint_t ( size ) *modulus __attribute__ (( may_alias ))
+		= ( ( const void * ) modulus0 );
+	bigint_t ( size ) *result __attribute__ (( may_alias ))
+		= ( ( void * ) result0 );
+
+	bigint_montgomery ( multiplicand, multiplier, modulus, modinv,
+			    result, tmp );
+}
+
 void bigint_mod_exp_sample ( const bigint_element_t *base0,
 			     const bigint_element_t *modulus0,
 			     const bigint_element_t *exponent0,
@@ -507,6 +534,54 @@ void bigint_mod_exp_sample ( const bigint_element_t *base0,
 		      sizeof ( result_raw ) ) == 0 );			\
 	} while ( 0 )
 
+/**
+ * Report result of big integer Montgomery multiplication test
+ *
+ * @v multiplicand	Big integer to be multiplied
+ * @v multiplier	Big integer to be multiplied
+ * @v modulus		Big integer modulus
+ * @v expected		Big integer expected result
+ */
+#define bigint_montgomery_ok( multiplicand, multiplier, modulus,	\
+			      expected ) do {				\
+	static const uint8_t multiplicand_raw[] = multiplicand;		\
+	static const uint8_t multiplier_raw[] = multiplier;		\
+	static const uint8_t modulus_raw[] = modulus;			\
+	static const uint8_t expected_raw[] = expected;			\
+	uint8_t result_raw[ sizeof ( expected_raw ) ];			\
+	unsigned int size =						\
+		bigint_required_size ( sizeof ( multiplicand_raw ) );	\
+	bigint_t ( size ) multiplicand_temp;				\
+	bigint_t ( size ) multiplier_temp;				\
+	bigint_t ( size ) modulus_temp;					\
+	bigint_t ( size ) result_temp;					\
+	size_t tmp_len = bigint_montgomery_tmp_len ( &modulus_temp );	\
+	uint8_t tmp[tmp_len];						\
+	bigint_element_t modinv;					\
+	{} /* Fix emacs alignment */					\
+									\
+	bigint_init ( &multiplicand_temp, multiplicand_raw,		\
+		      sizeof ( multiplicand_raw ) );			\
+	bigint_init ( &multiplier_temp, multiplier_raw,			\
+		      sizeof ( multiplier_raw ) );			\
+	bigint_init ( &modulus_temp, modulus_raw,			\
+		      sizeof ( modulus_raw ) );				\
+	modinv = bigint_montgomery_inverse ( &modulus_temp );		\
+	DBG ( "Montgomery multiply:\n" );				\
+	DBG_HDA ( 0, &multiplicand_temp, sizeof ( multiplicand_temp ) );\
+	DBG_HDA ( 0, &multiplier_temp, sizeof ( multiplier_temp ) );	\
+	DBG_HDA ( 0, &modulus_temp, sizeof ( modulus_temp ) );		\
+	ok ( ( modinv * modulus_temp.element[0] ) ==			\
+	     ( ( bigint_element_t ) -1 ) );				\
+	bigint_montgomery ( &multiplicand_temp, &multiplier_temp,	\
+			    &modulus_temp, modinv, &result_temp, tmp );	\
+	DBG_HDA ( 0, &result_temp, sizeof ( result_temp ) );		\
+	bigint_done ( &result_temp, result_raw, sizeof ( result_raw ) );\
+									\
+	ok ( memcmp ( result_raw, expected_raw,				\
+		      sizeof ( result_raw ) ) == 0 );			\
+	} while ( 0 )
+
 /**
  * Report result of big integer modular exponentiation test
  *
@@ -556,6 +631,83 @@ void bigint_mod_exp_sample ( const bigint_element_t *base0,
 		      sizeof ( result_raw ) ) == 0 );			\
 	} while ( 0 )
 
+/**
+ * Report modular multiplication and exponentiation costs
+ *
+ */
+static void bigint_profile ( void ) {
+	bigint_t ( PROFILE_SIZE ) multiplicand;
+	bigint_t ( PROFILE_SIZE ) multiplier;
+	bigint_t ( PROFILE_SIZE ) modulus;
+	bigint_t ( PROFILE_SIZE ) result;
+	bigint_t ( bigint_required_size ( 3 ) ) exponent;
+	static const uint8_t exponent_raw[] = { 0x01, 0x00, 0x01 };
+	uint8_t raw[ sizeof ( modulus ) ];
+	size_t mod_multiply_len = bigint_mod_multiply_tmp_len ( &modulus );
+	size_t montgomery_len = bigint_montgomery_tmp_len ( &modulus );
+	size_t mod_exp_len = bigint_mod_exp_tmp_len ( &modulus, &exponent );
+	uint8_t mod_multiply_tmp[mod_multiply_len];
+	uint8_t montgomery_tmp[montgomery_len];
+	uint8_t mod_exp_tmp[mod_exp_len];
+	struct profiler mod_multiply_profiler;
+	struct profiler montgomery_profiler;
+	struct profiler mod_exp_profiler;
+	bigint_element_t modinv;
+	unsigned int i;
+
+	/* Generate pseudo-random odd modulus with top bit set, and
+	 * pseudo-random multiplicand and multiplier less than the
+	 * modulus.
+	 */
+	srand ( 0x1234568 );
+	for ( i = 0 ; i < sizeof ( raw ) ; i++ )
+		raw[i] = rand();
+	raw[0] |= 0x80;
+	raw[ sizeof ( raw ) - 1 ] |= 0x01;
+	bigint_init ( &modulus, raw, sizeof ( raw ) );
+	for ( i = 0 ; i < sizeof ( raw ) ; i++ )
+		raw[i] = rand();
+	raw[0] &= 0x7f;
+	bigint_init ( &multiplicand, raw, sizeof ( raw ) );
+	for ( i = 0 ; i < sizeof ( raw ) ; i++ )
+		raw[i] = rand();
+	raw[0] &= 0x7f;
+	bigint_init ( &multiplier, raw, sizeof ( raw ) );
+	bigint_init ( &exponent, exponent_raw, sizeof ( exponent_raw ) );
+	modinv = bigint_montgomery_inverse ( &modulus );
+
+	/* Profile operations */
+	memset ( &mod_multiply_profiler, 0,
+		 sizeof ( mod_multiply_profiler ) );
+	memset ( &montgomery_profiler, 0, sizeof ( montgomery_profiler ) );
+	memset ( &mod_exp_profiler, 0, sizeof ( mod_exp_profiler ) );
+	for ( i = 0 ; i < PROFILE_COUNT ; i++ ) {
+		profile_start ( &mod_multiply_profiler );
+		bigint_mod_multiply ( &multiplicand, &multiplier, &modulus,
+				      &result, mod_multiply_tmp );
+		profile_stop ( &mod_multiply_profiler );
+		profile_start ( &montgomery_profiler );
+		bigint_montgomery ( &multiplicand, &multiplier, &modulus,
+				    modinv, &result, montgomery_tmp );
+		profile_stop ( &montgomery_profiler );
+		profile_start ( &mod_exp_profiler );
+		bigint_mod_exp ( &multiplicand, &modulus, &exponent, &result,
+				 mod_exp_tmp );
+		profile_stop ( &mod_exp_profiler );
+	}
+	DBG ( "BIGINT %zd-bit modular multiplication in %ld +/- %ld ticks\n",
+	      ( 8 * sizeof ( modulus ) ), profile_mean ( &mod_multiply_profiler ),
+	      profile_stddev ( &mod_multiply_profiler ) );
+	DBG ( "BIGINT %zd-bit Montgomery multiplication in %ld +/- %ld "
+	      "ticks\n", ( 8 * sizeof ( modulus ) ),
+	      profile_mean ( &montgomery_profiler ),
+	      profile_stddev ( &montgomery_profiler ) );
+	DBG ( "BIGINT %zd-bit modular exponentiation (e=65537) in %ld +/- %ld "
+	      "ticks\n", ( 8 * sizeof ( modulus ) ),
+	      profile_mean ( &mod_exp_profiler ),
+	      profile_stddev ( &mod_exp_profiler ) );
+}
+
 /**
  * Perform big integer self-tests
  *
@@ -1712,6 +1864,54 @@ static void bigint_test_exec ( void ) {
 					  0x50, 0xc0, 0xb9, 0x95, 0xb0, 0x7d,
 					  0x7c, 0xca, 0x63, 0xf8, 0x72, 0xbe,
 					  0x3b, 0x00 ) );
+	bigint_montgomery_ok ( BIGINT ( 0x1c ),
+			       BIGINT ( 0x06 ),
+			       BIGINT ( 0xa3 ),
+			       BIGINT ( 0x6a ) );
+	bigint_montgomery_ok ( BIGINT ( 0x46, 0x68 ),
+			       BIGINT ( 0x3e, 0xb1 ),
+			       BIGINT ( 0xbd, 0xd7 ),
+			       BIGINT ( 0x75, 0xeb ) );
+	bigint_montgomery_ok ( BIGINT ( 0x23, 0xb8, 0xc1 ),
+			       BIGINT ( 0x1a, 0x3d, 0x1f ),
+			       BIGINT ( 0xb9, 0x24, 0x57 ),
+			       BIGINT ( 0x92, 0x39, 0x9b ) );
+	bigint_montgomery_ok ( BIGINT ( 0xbd, 0x9c, 0x66, 0xb3 ),
+			       BIGINT ( 0x8b, 0x9d, 0x24, 0x34 ),
+			       BIGINT ( 0xad, 0x3c, 0x2d, 0x6d ),
+			       BIGINT ( 0x83, 0xbd, 0x04, 0x27 ) );
+	bigint_montgomery_ok ( BIGINT ( 0x17, 0xfc, 0x07, 0xa0, 0xca, 0x6e,
+					0x08, 0x22, 0xe8, 0xf3 ),
+			       BIGINT ( 0x81, 0x5e, 0x3b, 0x8f, 0xaa, 0x18,
+					0x37, 0xf8, 0xa8, 0x8b ),
+			       BIGINT ( 0xec, 0x03, 0x97, 0x2a, 0x84, 0x69,
+					0x16, 0x41, 0x9f, 0x83 ),
+			       BIGINT ( 0x64, 0xd1, 0x4b, 0x67, 0x0e, 0x39,
+					0x96, 0x6a, 0xdc, 0xbd ) );
+	bigint_montgomery_ok ( BIGINT ( 0xce, 0xc2, 0x41, 0x33, 0x0b, 0x01,
+					0xa9, 0xe7, 0x1f, 0xde, 0x8a, 0x77,
+					0x4b, 0xcf, 0x36, 0xd5, 0x8b, 0x47,
+					0x37, 0x81, 0x90, 0x96, 0xda, 0x1d,
+					0xac, 0x72, 0xff, 0x5d, 0x2a, 0x38,
+					0x6e, 0xcb, 0xe0 ),
+			       BIGINT ( 0xc3, 0xf5, 0x0b, 0xea, 0x63, 0x37,
+					0x1e, 0xcd, 0x7b, 0x27, 0xcd, 0x81,
+					0x30, 0x47, 0x22, 0x93, 0x89, 0x57,
+					0x1a, 0xa8, 0x76, 0x6c, 0x30, 0x75,
+					0x11, 0xb2, 0xb9, 0x43, 0x7a, 0x28,
+					0xdf, 0x6e, 0xc4 ),
+			       BIGINT ( 0xeb, 0x8b, 0x81, 0x48, 0xf6, 0xb3,
+					0x8a, 0x08, 0x8c, 0xa6, 0x5e, 0xd3,
+					0x89, 0xb7, 0x4d, 0x0f, 0xb1, 0x32,
+					0xe7, 0x06, 0x29, 0x8f, 0xad, 0xc1,
+					0xa6, 0x06, 0xcb, 0x0f, 0xb3, 0x9a,
+					0x1d, 0xe6, 0x45 ),
+			       BIGINT ( 0x84, 0x51, 0xe2, 0xc8, 0x79, 0xba,
+					0xe9, 0x01, 0xa8, 0xa4, 0x82, 0xa4,
+					0x7b, 0xfb, 0x07, 0xe6, 0xda, 0x9b,
+					0x9e, 0xed, 0x24, 0x8d, 0x8b, 0x6c,
+					0xc4, 0x4a, 0x24, 0x57, 0x38, 0xf6,
+					0x0c, 0x54, 0xed ) );
 	bigint_mod_exp_ok ( BIGINT ( 0xcd ),
 			    BIGINT ( 0xbb ),
 			    BIGINT ( 0x25 ),
@@ -2432,6 +2632,9 @@ static void bigint_test_exec ( void ) {
 				     0xfa, 0x83, 0xd4, 0x7c, 0xe9, 0x77,
 				     0x46, 0x91, 0x3a, 0x50, 0x0d, 0x6a,
 				     0x25, 0xd0 ) );
+
+	/* Speed tests */
+	bigint_profile();
 }
 
 /** Big integer self-test */
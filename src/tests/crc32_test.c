@@ -40,9 +40,16 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #undef NDEBUG
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
 #include <ipxe/crc32.h>
+#include <ipxe/profile.h>
 #include <ipxe/test.h>
 
+/** Number of sample iterations for profiling */
+#define PROFILE_COUNT 16
+
 /** Define inline data */
 #define DATA(...) { __VA_ARGS__ }
 
@@ -76,6 +83,28 @@ struct crc32_test {
 		.crc32 = CRC32,						\
 	};
 
+/** A CRC32 pseudorandom-data test */
+struct crc32_random_test {
+	/** Seed for pseudorandom data */
+	unsigned int seed;
+	/** Length of data */
+	size_t len;
+	/** Alignment offset */
+	size_t offset;
+};
+
+/** Define a CRC32 pseudorandom-data test */
+#define CRC32_RANDOM_TEST( name, SEED, LEN, OFFSET )			\
+	static struct crc32_random_test name = {			\
+		.seed = SEED,						\
+		.len = LEN,						\
+		.offset = OFFSET,					\
+	}
+
+/** Buffer for pseudorandom-data tests */
+static uint8_t __attribute__ (( aligned ( 16 ) ))
+	crc32_data[ 8192 + 15 /* offset */ ];
+
 /**
  * Report a CRC32 test result
  *
@@ -83,10 +112,92 @@ struct crc32_test {
  */
 #define crc32_ok( test ) do {						\
 	uint32_t crc32;							\
+	crc32 = generic_crc32_le ( (test)->seed, (test)->data,		\
+				   (test)->len );			\
+	ok ( crc32 == (test)->crc32 );					\
 	crc32 = crc32_le ( (test)->seed, (test)->data, (test)->len );	\
 	ok ( crc32 == (test)->crc32 );					\
 	} while ( 0 )
 
+/**
+ * Calculate CRC32 one bit at a time
+ *
+ * @v seed		Initial value
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret crc		CRC32
+ *
+ * This is a reference implementation, used to verify the optimised
+ * implementations.
+ */
+static uint32_t bitwise_crc32_le ( uint32_t seed, const void *data,
+				   size_t len ) {
+	const uint8_t *src = data;
+	uint32_t crc = seed;
+	unsigned int i;
+
+	while ( len-- ) {
+		crc ^= *(src++);
+		for ( i = 0 ; i < 8 ; i++ ) {
+			crc = ( ( crc >> 1 ) ^
+				( ( crc & 1 ) ? 0xedb88320UL : 0 ) );
+		}
+	}
+	return crc;
+}
+
+/**
+ * Report CRC32 pseudorandom-data test result
+ *
+ * @v test		CRC32 test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void crc32_random_okx ( struct crc32_random_test *test,
+			       const char *file, unsigned int line ) {
+	uint8_t *data = ( crc32_data + test->offset );
+	struct profiler generic_profiler;
+	struct profiler profiler;
+	uint32_t expected;
+	uint32_t crc32;
+	unsigned int i;
+
+	/* Sanity check */
+	assert ( ( test->len + test->offset ) <= sizeof ( crc32_data ) );
+
+	/* Generate random data */
+	srandom ( test->seed );
+	for ( i = 0 ; i < test->len ; i++ )
+		data[i] = random();
+
+	/* Verify generic_crc32_le() result */
+	expected = bitwise_crc32_le ( 0xffffffffUL, data, test->len );
+	crc32 = generic_crc32_le ( 0xffffffffUL, data, test->len );
+	okx ( crc32 == expected, file, line );
+
+	/* Verify optimised crc32_le() result */
+	crc32 = crc32_le ( 0xffffffffUL, data, test->len );
+	okx ( crc32 == expected, file, line );
+
+	/* Profile generic and optimised calculations */
+	memset ( &generic_profiler, 0, sizeof ( generic_profiler ) );
+	memset ( &profiler, 0, sizeof ( profiler ) );
+	for ( i = 0 ; i < PROFILE_COUNT ; i++ ) {
+		profile_start ( &generic_profiler );
+		crc32 = generic_crc32_le ( 0xffffffffUL, data, test->len );
+		profile_stop ( &generic_profiler );
+		profile_start ( &profiler );
+		crc32 = crc32_le ( 0xffffffffUL, data, test->len );
+		profile_stop ( &profiler );
+	}
+	DBG ( "CRC32 checksummed %zd bytes (+%zd) in %ld +/- %ld ticks "
+	      "(generic %ld +/- %ld ticks)\n", test->len, test->offset,
+	      profile_mean ( &profiler ), profile_stddev ( &profiler ),
+	      profile_mean ( &generic_profiler ),
+	      profile_stddev ( &generic_profiler ) );
+}
+#define crc32_random_ok( test ) crc32_random_okx ( test, __FILE__, __LINE__ )
+
 /* CRC32 tests */
 CRC32_TEST ( empty_test,
 	     DATA ( ),
@@ -101,6 +212,24 @@ CRC32_TEST ( hw_split_part2_test,
 	     DATA ( ' ', 'w', 'o', 'r', 'l', 'd' ),
 	     0xc9ef5979UL, 0xf2b5ee7aUL );
 
+/** Random data (aligned) */
+CRC32_RANDOM_TEST ( random_aligned, 0x12345678UL, 8192, 0 );
+
+/** Random data (unaligned, +1) */
+CRC32_RANDOM_TEST ( random_unaligned_1, 0x12345678UL, 8192, 1 );
+
+/** Random data (unaligned, +15) */
+CRC32_RANDOM_TEST ( random_unaligned_15, 0x12345678UL, 8192, 15 );
+
+/** Random data (aligned, truncated) */
+CRC32_RANDOM_TEST ( random_aligned_truncated, 0x12345678UL, 8191, 0 );
+
+/** Random data (minimum length for folding) */
+CRC32_RANDOM_TEST ( random_fold_min, 0xcafebabeUL, 64, 0 );
+
+/** Random data (unaligned start and finish) */
+CRC32_RANDOM_TEST ( partial, 0xcafebabeUL, 121, 5 );
+
 /**
  * Perform CRC32 self-tests
  *
@@ -111,6 +240,12 @@ static void crc32_test_exec ( void ) {
 	crc32_ok ( &hw_test );
 	crc32_ok ( &hw_split_part1_test );
 	crc32_ok ( &hw_split_part2_test );
+	crc32_random_ok ( &random_aligned );
+	crc32_random_ok ( &random_unaligned_1 );
+	crc32_random_ok ( &random_unaligned_15 );
+	crc32_random_ok ( &random_aligned_truncated );
+	crc32_random_ok ( &random_fold_min );
+	crc32_random_ok ( &partial );
 }
 
 /** CRC32 self-test */
@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Data transfer buffer tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/xfer.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/xferbuf.h>
+#include <ipxe/profile.h>
+#include <ipxe/test.h>
+
+/** Number of sample iterations for profiling */
+#define PROFILE_COUNT 4
+
+/** Length of simulated download used for profiling */
+#define PROFILE_LEN ( 4 * 1024 * 1024 )
+
+/** Length of each simulated packet */
+#define PACKET_LEN 1460
+
+/** Length of simulated download used for growth tests */
+#define GROWTH_LEN ( 64 * 1024 )
+
+/** Number of reallocations performed */
+static unsigned int xferbuf_test_reallocs;
+
+/** Simulated packet payload */
+static uint8_t xferbuf_test_packet[PACKET_LEN];
+
+/**
+ * Reallocate data buffer (counting reallocations)
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v len		New allocated length (or zero to free)
+ * @ret rc		Return status code
+ */
+static int xferbuf_test_realloc ( struct xfer_buffer *xferbuf, size_t len ) {
+
+	xferbuf_test_reallocs++;
+	return xferbuf_malloc_operations.realloc ( xferbuf, len );
+}
+
+/** Counting malloc()-based data buffer operations */
+static struct xfer_buffer_operations xferbuf_test_operations;
+
+/**
+ * Deliver simulated packet to data transfer buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v data		Packet data
+ * @v len		Length of packet data
+ * @v flags		Metadata flags
+ * @v offset		Metadata offset
+ * @ret rc		Return status code
+ */
+static int xferbuf_test_deliver ( struct xfer_buffer *xferbuf,
+				  const void *data, size_t len,
+				  unsigned int flags, off_t offset ) {
+	struct xfer_metadata meta;
+	struct io_buffer *iobuf;
+
+	iobuf = alloc_iob ( len );
+	assert ( iobuf != NULL );
+	memcpy ( iob_put ( iobuf, len ), data, len );
+	memset ( &meta, 0, sizeof ( meta ) );
+	meta.flags = flags;
+	meta.offset = offset;
+	return xferbuf_deliver ( xferbuf, iobuf, &meta );
+}
+
+/**
+ * Report basic read/write test result
+ *
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void xferbuf_basic_okx ( const char *file, unsigned int line ) {
+	static const char hello[] = "Hello";
+	static const char world[] = "world";
+	struct xfer_buffer xferbuf;
+	char buf[16];
+
+	memset ( &xferbuf, 0, sizeof ( xferbuf ) );
+	xferbuf_malloc_init ( &xferbuf );
+
+	/* Deliver data at relative and absolute offsets */
+	okx ( xferbuf_test_deliver ( &xferbuf, hello, 5, 0, 0 ) == 0,
+	      file, line );
+	okx ( xferbuf_test_deliver ( &xferbuf, world, 5, 0, 1 ) == 0,
+	      file, line );
+	okx ( xferbuf_test_deliver ( &xferbuf, ",", 1, XFER_FL_ABS_OFFSET,
+				     5 ) == 0, file, line );
+	okx ( xferbuf.len == 11, file, line );
+	okx ( xferbuf.pos == 6, file, line );
+	okx ( xferbuf.alloc >= xferbuf.len, file, line );
+
+	/* Read back data */
+	memset ( buf, 0, sizeof ( buf ) );
+	okx ( xferbuf_read ( &xferbuf, 0, buf, 5 ) == 0, file, line );
+	okx ( xferbuf_read ( &xferbuf, 6, ( buf + 6 ), 5 ) == 0, file, line );
+	okx ( xferbuf_read ( &xferbuf, 5, ( buf + 5 ), 1 ) == 0, file, line );
+	okx ( memcmp ( buf, "Hello,world", 11 ) == 0, file, line );
+
+	/* Reads beyond the end of the data must fail */
+	okx ( xferbuf_read ( &xferbuf, 8, buf, 4 ) != 0, file, line );
+	okx ( xferbuf_read ( &xferbuf, 12, buf, 0 ) != 0, file, line );
+
+	/* Trimming should release any excess allocation */
+	xferbuf_trim ( &xferbuf );
+	okx ( xferbuf.alloc == xferbuf.len, file, line );
+	okx ( xferbuf_read ( &xferbuf, 0, buf, 11 ) == 0, file, line );
+	okx ( memcmp ( buf, "Hello,world", 11 ) == 0, file, line );
+
+	/* Finishing should free the buffer */
+	xferbuf_done ( &xferbuf );
+	okx ( xferbuf.data == NULL, file, line );
+	okx ( xferbuf.len == 0, file, line );
+	okx ( xferbuf.alloc == 0, file, line );
+}
+#define xferbuf_basic_ok() xferbuf_basic_okx ( __FILE__, __LINE__ )
+
+/**
+ * Report growth test result
+ *
+ * @v hint		Provide a size hint before delivering data
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void xferbuf_growth_okx ( int hint, const char *file,
+				 unsigned int line ) {
+	struct xfer_buffer xferbuf;
+	size_t remaining;
+	size_t frag_len;
+	size_t offset;
+	uint8_t *data;
+	int rc = 0;
+
+	memset ( &xferbuf, 0, sizeof ( xferbuf ) );
+	xferbuf.op = &xferbuf_test_operations;
+	xferbuf_test_reallocs = 0;
+
+	/* Provide size hint (as xfer_seek() would do), if applicable */
+	if ( hint ) {
+		okx ( xferbuf_test_deliver ( &xferbuf, NULL, 0,
+					     XFER_FL_ABS_OFFSET,
+					     GROWTH_LEN ) == 0, file, line );
+		okx ( xferbuf.len == GROWTH_LEN, file, line );
+		okx ( xferbuf.alloc == GROWTH_LEN, file, line );
+		okx ( xferbuf_test_deliver ( &xferbuf, NULL, 0,
+					     XFER_FL_ABS_OFFSET, 0 ) == 0,
+		      file, line );
+	}
+
+	/* Deliver data in packet-sized fragments */
+	for ( remaining = GROWTH_LEN ; remaining ; remaining -= frag_len ) {
+		frag_len = remaining;
+		if ( frag_len > sizeof ( xferbuf_test_packet ) )
+			frag_len = sizeof ( xferbuf_test_packet );
+		memset ( xferbuf_test_packet, ( remaining & 0xff ), frag_len );
+		if ( ( rc = xferbuf_test_deliver ( &xferbuf,
+						   xferbuf_test_packet,
+						   frag_len, 0, 0 ) ) != 0 )
+			break;
+	}
+	okx ( rc == 0, file, line );
+	okx ( xferbuf.len == GROWTH_LEN, file, line );
+	okx ( xferbuf.pos == GROWTH_LEN, file, line );
+
+	/* Check number of reallocations: a single allocation if a
+	 * hint was provided, otherwise logarithmic in the final size.
+	 */
+	if ( hint ) {
+		okx ( xferbuf_test_reallocs == 1, file, line );
+	} else {
+		okx ( xferbuf_test_reallocs <= 16, file, line );
+	}
+
+	/* Check content */
+	data = xferbuf.data;
+	for ( remaining = GROWTH_LEN, offset = 0 ; remaining ;
+	      remaining -= frag_len, offset += frag_len ) {
+		frag_len = remaining;
+		if ( frag_len > sizeof ( xferbuf_test_packet ) )
+			frag_len = sizeof ( xferbuf_test_packet );
+		okx ( data[offset] == ( remaining & 0xff ), file, line );
+		okx ( data[ offset + frag_len - 1 ] == ( remaining & 0xff ),
+		      file, line );
+	}
+
+	/* Check trimming */
+	xferbuf_trim ( &xferbuf );
+	okx ( xferbuf.alloc == GROWTH_LEN, file, line );
+	xferbuf_done ( &xferbuf );
+}
+#define xferbuf_growth_ok( hint ) \
+	xferbuf_growth_okx ( hint, __FILE__, __LINE__ )
+
+/**
+ * Report umalloc()-based buffer test result
+ *
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void xferbuf_umalloc_okx ( const char *file, unsigned int line ) {
+	static const char data[] = "umalloc()-based data";
+	struct xfer_buffer xferbuf;
+	userptr_t udata = UNULL;
+	char buf[ sizeof ( data ) ];
+
+	memset ( &xferbuf, 0, sizeof ( xferbuf ) );
+	xferbuf_umalloc_init ( &xferbuf, &udata );
+	okx ( xferbuf_write ( &xferbuf, 0, data, sizeof ( data ) ) == 0,
+	      file, line );
+	okx ( udata != UNULL, file, line );
+	okx ( xferbuf.len == sizeof ( data ), file, line );
+	xferbuf_trim ( &xferbuf );
+	copy_from_user ( buf, udata, 0, sizeof ( buf ) );
+	okx ( memcmp ( buf, data, sizeof ( data ) ) == 0, file, line );
+	xferbuf_done ( &xferbuf );
+	okx ( udata == UNULL, file, line );
+}
+#define xferbuf_umalloc_ok() xferbuf_umalloc_okx ( __FILE__, __LINE__ )
+
+/**
+ * Profile simulated download into a umalloc()-based buffer
+ *
+ * @v name		Policy name
+ * @v hint		Provide a size hint before delivering data
+ * @v exact		Emulate exact-size growth
+ */
+static void xferbuf_profile ( const char *name, int hint, int exact ) {
+	struct profiler profiler;
+	struct xfer_buffer xferbuf;
+	userptr_t udata;
+	size_t offset;
+	size_t frag_len;
+	unsigned int i;
+
+	/* Profile simulated downloads */
+	memset ( &profiler, 0, sizeof ( profiler ) );
+	for ( i = 0 ; i < PROFILE_COUNT ; i++ ) {
+		memset ( &xferbuf, 0, sizeof ( xferbuf ) );
+		udata = UNULL;
+		xferbuf_umalloc_init ( &xferbuf, &udata );
+		profile_start ( &profiler );
+		if ( hint )
+			assert ( xferbuf_presize ( &xferbuf,
+						   PROFILE_LEN ) == 0 );
+		for ( offset = 0 ; offset < PROFILE_LEN ; offset += frag_len ) {
+			frag_len = ( PROFILE_LEN - offset );
+			if ( frag_len > sizeof ( xferbuf_test_packet ) )
+				frag_len = sizeof ( xferbuf_test_packet );
+			if ( exact ) {
+				assert ( xferbuf_presize ( &xferbuf,
+							   ( offset +
+							     frag_len ) ) == 0);
+			}
+			assert ( xferbuf_write ( &xferbuf, offset,
+						 xferbuf_test_packet,
+						 frag_len ) == 0 );
+		}
+		xferbuf_trim ( &xferbuf );
+		profile_stop ( &profiler );
+		xferbuf_done ( &xferbuf );
+	}
+	DBG ( "XFERBUF %s download of %d bytes: %ld +/- %ld ticks\n",
+	      name, PROFILE_LEN, profile_mean ( &profiler ),
+	      profile_stddev ( &profiler ) );
+}
+
+/**
+ * Perform data transfer buffer self-tests
+ *
+ */
+static void xferbuf_test_exec ( void ) {
+
+	/* Construct counting operations */
+	memcpy ( &xferbuf_test_operations, &xferbuf_malloc_operations,
+		 sizeof ( xferbuf_test_operations ) );
+	xferbuf_test_operations.realloc = xferbuf_test_realloc;
+
+	/* Correctness tests */
+	xferbuf_basic_ok();
+	xferbuf_growth_ok ( 0 );
+	xferbuf_growth_ok ( 1 );
+	xferbuf_umalloc_ok();
+
+	/* Speed tests */
+	xferbuf_profile ( "exact-growth", 0, 1 );
+	xferbuf_profile ( "geometric-growth", 0, 0 );
+	xferbuf_profile ( "size-hinted", 1, 0 );
+}
+
+/** Data transfer buffer self-test */
+struct self_test xferbuf_test __self_test = {
+	.name = "xferbuf",
+	.exec = xferbuf_test_exec,
+};
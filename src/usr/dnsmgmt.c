@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdio.h>
+#include <string.h>
+#include <ipxe/timer.h>
+#include <ipxe/socket.h>
+#include <ipxe/in.h>
+#include <ipxe/dns.h>
+#include <usr/dnsmgmt.h>
+
+/** @file
+ *
+ * DNS management
+ *
+ */
+
+/**
+ * Print DNS cache statistics and contents
+ *
+ */
+void dnsstat ( void ) {
+	struct dns_cache_statistics *stats = &dns_cache_stats;
+	struct dns_cache_entry *entry;
+	union {
+		struct sockaddr sa;
+		struct sockaddr_in sin;
+		struct sockaddr_in6 sin6;
+	} address;
+	unsigned long lookups;
+	unsigned long remaining;
+
+	/* Print statistics */
+	lookups = ( stats->hits + stats->negative_hits + stats->misses );
+	printf ( "DNS cache: Hits:%ld NegativeHits:%ld Misses:%ld (%ld%% hit "
+		 "rate)\n", stats->hits, stats->negative_hits, stats->misses,
+		 ( lookups ? ( ( 100 * ( lookups - stats->misses ) ) /
+			       lookups ) : 0 ) );
+	printf ( "  Insertions:%ld Expirations:%ld Evictions:%ld\n",
+		 stats->insertions, stats->expirations, stats->evictions );
+
+	/* Print cache entries */
+	list_for_each_entry ( entry, &dns_cache, list ) {
+		remaining = dns_cache_remaining ( entry );
+		if ( ! remaining )
+			continue;
+		printf ( "%s ", entry->name );
+		if ( entry->rc == 0 ) {
+			memset ( &address, 0, sizeof ( address ) );
+			address.sa.sa_family = entry->family;
+			if ( entry->family == AF_INET6 ) {
+				memcpy ( &address.sin6.sin6_addr,
+					 &entry->address.in6,
+					 sizeof ( address.sin6.sin6_addr ) );
+			} else {
+				address.sin.sin_addr = entry->address.in;
+			}
+			printf ( "is %s", sock_ntoa ( &address.sa ) );
+		} else {
+			printf ( "does not exist" );
+		}
+		printf ( " (expires in %lds)\n",
+			 ( remaining / TICKS_PER_SEC ) );
+	}
+}